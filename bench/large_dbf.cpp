@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * @file large_dbf.cpp
+ * @brief Regression benchmark: converts a synthetic DBC file whose DBF is
+ * larger than 4 GiB and checks that every byte range came through.
+ *
+ * The DBC file is generated on the fly as a literal-only PKWARE DCL stream
+ * of 100-byte records (ROWID N(12), TXT C(75), TAIL N(12)), so its size is
+ * only bounded by the disk. Each record carries its own row number and the
+ * number of rows after it, so a record read from a wrapped 32-bit offset
+ * would show up as a wrong value. After the conversion, the row groups
+ * holding the first row, the rows at the 2 GiB and 4 GiB byte offsets and
+ * the last row are read back and checked value by value, along with the
+ * row count.
+ *
+ * Usage: bench_large_dbf WORK_DIR [ROWS] [--keep]
+ * ROWS defaults to 45,000,000 (a 4.2 GiB DBF). The benchmark needs about
+ * that much memory for the decompressed DBF and 1.1 times as much free disk
+ * for the DBC file.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+#include "batch_convert.hpp"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+/*! bytes per record, deletion flag included */
+static constexpr int kRecordLength = 100;
+static constexpr int64_t kDefaultRows = 45000000;
+
+/*! \class BitWriter
+	\brief Writes the LSB-first bit stream of a PKWARE DCL (blast) file
+*/
+class BitWriter {
+public:
+    explicit BitWriter(FILE* file) : file_(file) {}
+
+    void put(const uint32_t value, const int bits) {
+        bits_ |= static_cast<uint64_t>(value) << count_;
+        count_ += bits;
+        while (count_ >= 8) {
+            buffer_.push_back(static_cast<unsigned char>(bits_ & 0xFF));
+            bits_ >>= 8;
+            count_ -= 8;
+        }
+        if (buffer_.size() >= (1 << 20)) flush();
+    }
+
+    /*! an uncoded literal: a 0 flag bit, then the byte */
+    void literal(const unsigned char byte) { put(static_cast<uint32_t>(byte) << 1, 9); }
+
+    bool finish() {
+        if (count_ > 0) buffer_.push_back(static_cast<unsigned char>(bits_ & 0xFF));
+        count_ = 0;
+        return flush();
+    }
+
+private:
+    bool flush() {
+        const bool ok = std::fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+        buffer_.clear();
+        return ok;
+    }
+
+    FILE* file_;
+    std::vector<unsigned char> buffer_;
+    uint64_t bits_ = 0;
+    int count_ = 0;
+};
+
+/**
+ * @brief Writes the synthetic DBC file.
+ *
+ * @param path Path of the DBC file.
+ * @param rows Number of records.
+ * @return bool false if the file could not be written.
+ */
+static bool generate_dbc(const std::string& path, const uint32_t rows) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    struct FieldDef {
+        const char* name;
+        char type;
+        int length;
+    };
+    const FieldDef fields[] = {{"ROWID", 'N', 12}, {"TXT", 'C', 75}, {"TAIL", 'N', 12}};
+
+    // DBF header, then one 32-byte descriptor per field and the 0x0D terminator
+    unsigned char header[32 + 32 * 3 + 1] = {};
+    const uint16_t header_length = sizeof(header);
+    const uint16_t record_length = kRecordLength;
+    header[0] = 0x03;
+    std::memcpy(header + 4, &rows, 4);
+    std::memcpy(header + 8, &header_length, 2);
+    std::memcpy(header + 10, &record_length, 2);
+    for (int i = 0; i < 3; i++) {
+        unsigned char* descriptor = header + 32 + 32 * i;
+        std::strcpy(reinterpret_cast<char*>(descriptor), fields[i].name);
+        descriptor[11] = static_cast<unsigned char>(fields[i].type);
+        descriptor[16] = static_cast<unsigned char>(fields[i].length);
+    }
+    header[sizeof(header) - 1] = 0x0D;
+
+    // DBC: the header, a 4-byte CRC (not checked), then the compressed records
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) && std::fwrite("\0\0\0\0", 1, 4, file) == 4;
+
+    BitWriter stream(file);
+    stream.put(0, 8);  // literals are not Huffman-coded
+    stream.put(6, 8);  // 4 KiB dictionary
+    char record[kRecordLength + 1];
+    for (uint32_t row = 0; ok && row < rows; row++) {
+        std::snprintf(record, sizeof(record), " %12" PRIu32 "%-75s%12" PRIu32, row, "synthetic text", rows - row);
+        for (int i = 0; i < kRecordLength; i++) stream.literal(static_cast<unsigned char>(record[i]));
+    }
+    stream.literal(0x1A);
+    // End-of-stream code: length symbol 519
+    stream.put(1, 1);
+    stream.put(0, 7);
+    stream.put(255, 8);
+    ok = stream.finish() && ok;
+
+    return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * @brief Reads back the row groups holding the given rows and checks their values.
+ *
+ * @param path Path of the Parquet file.
+ * @param rows Number of records written.
+ * @param probes Rows whose row group is checked.
+ * @return arrow::Status OK if every checked value matches its row.
+ */
+static arrow::Status verify_parquet(const std::string& path, const int64_t rows, const std::vector<int64_t>& probes) {
+    ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    ARROW_ASSIGN_OR_RAISE(reader, parquet::arrow::OpenFile(input, arrow::default_memory_pool()));
+
+    const auto metadata = reader->parquet_reader()->metadata();
+    if (metadata->num_rows() != rows)
+        return arrow::Status::Invalid("expected ", rows, " rows, found ", metadata->num_rows());
+
+    std::set<int> groups;
+    std::vector<int64_t> group_start(metadata->num_row_groups() + 1, 0);
+    for (int group = 0; group < metadata->num_row_groups(); group++) {
+        group_start[group + 1] = group_start[group] + metadata->RowGroup(group)->num_rows();
+        for (const int64_t probe : probes) {
+            if (probe >= group_start[group] && probe < group_start[group + 1]) groups.insert(group);
+        }
+    }
+
+    for (const int group : groups) {
+        std::shared_ptr<arrow::Table> table;
+        ARROW_RETURN_NOT_OK(reader->ReadRowGroup(group, {0, 2}, &table));
+        ARROW_ASSIGN_OR_RAISE(table, table->CombineChunks());
+        const auto rowid = std::dynamic_pointer_cast<arrow::Int64Array>(table->column(0)->chunk(0));
+        const auto tail = std::dynamic_pointer_cast<arrow::Int64Array>(table->column(1)->chunk(0));
+        if (!rowid || !tail) return arrow::Status::TypeError("ROWID and TAIL should be int64");
+
+        for (int64_t i = 0; i < table->num_rows(); i++) {
+            const int64_t row = group_start[group] + i;
+            if (rowid->Value(i) != row || tail->Value(i) != rows - row)
+                return arrow::Status::Invalid("row ", row, " reads back as ROWID ", rowid->Value(i), ", TAIL ", tail->Value(i));
+        }
+        std::cout << "  row group " << group << ": rows " << group_start[group] << " to " << group_start[group + 1] - 1 << " ok\n";
+    }
+    return arrow::Status::OK();
+}
+
+int main(const int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " WORK_DIR [ROWS] [--keep]\n";
+        return 2;
+    }
+    const fs::path dir = argv[1];
+    int64_t rows = kDefaultRows;
+    bool keep = false;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--keep") == 0) keep = true;
+        else rows = std::atoll(argv[i]);
+    }
+    if (rows <= 0 || rows > UINT32_MAX) {
+        std::cerr << "ROWS must be between 1 and " << UINT32_MAX << "\n";
+        return 2;
+    }
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    const std::string dbc = (dir / "large.dbc").string();
+    const std::string parquet = (dir / "large.parquet").string();
+    const int64_t dbf_bytes = 32 + 32 * 3 + 1 + rows * kRecordLength;
+    std::cout << "Rows: " << rows << ", DBF size: " << dbf_bytes / double(1 << 30) << " GiB\n";
+    if (dbf_bytes <= (int64_t{1} << 32)) std::cout << "Warning: the DBF does not reach the 4 GiB offset limit\n";
+
+    auto start = Clock::now();
+    if (!generate_dbc(dbc, static_cast<uint32_t>(rows))) {
+        std::cerr << "Cannot write " << dbc << "\n";
+        return 1;
+    }
+    std::cout << "Generated " << dbc << " in " << std::chrono::duration<double>(Clock::now() - start).count() << " s\n";
+
+    start = Clock::now();
+    auto status = convert_file(dbc, parquet, ConvertOptions{});
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!keep) fs::remove(dbc, ec);
+    if (!status.ok()) {
+        std::cerr << "Conversion failed: " << status.ToString() << "\n";
+        return 1;
+    }
+    std::cout << "Converted in " << seconds << " s (" << dbf_bytes / seconds / (1 << 20) << " MiB/s of DBF)\n";
+
+    const std::vector<int64_t> probes = {0, (int64_t{1} << 31) / kRecordLength, (int64_t{1} << 32) / kRecordLength, rows - 1};
+    status = verify_parquet(parquet, rows, probes);
+    if (!keep) fs::remove(parquet, ec);
+    if (!status.ok()) {
+        std::cerr << "FAILED: " << status.ToString() << "\n";
+        return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}
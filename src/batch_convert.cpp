@@ -0,0 +1,558 @@
+/*****************************************************************************
+ * @file batch_convert.cpp
+ * @brief Converts one or many DBC files to Parquet.
+ *
+ * A multi-file run takes any mix of DBC files, directories (searched
+ * recursively for *.dbc), wildcard patterns and file lists, and converts
+ * them inside one process, so the Arrow runtime and thread pool are set up
+ * once instead of once per file. Files are scheduled largest first, by the
+ * decompressed size announced in their DBC header, so that a big file
+ * picked up last does not leave the other threads idle at the end of the
+ * run. A file that fails is reported and does not stop the others.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include "batch_convert.hpp"
+#include "dbf_reader.hpp"
+#include "json.hpp"
+#include "small_file_reader.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Generates an output filename for the Parquet file based on the input
+ * filename.
+ *
+ * This function takes the input filename, removes its extension (if any),
+ * and appends ".parquet" to create the output filename.
+ *
+ * @param input_file The input filename (including path if applicable).
+ * @param extension The extension of the output format, with the dot.
+ * @return std::string The generated output filename for the Parquet file.
+ */
+std::string generate_output_filename(const std::string& input_file, const std::string& extension) {
+    std::string output = input_file;
+    size_t pos = output.find_last_of('.');
+    if (pos != std::string::npos) {
+        output = output.substr(0, pos);
+    }
+    output += extension;
+    return output;
+}
+
+/*! Lends a buffer from the options' BufferPool to a DBF for one conversion. */
+struct PooledBuffer {
+    BufferPool* pool;
+    DBF& dbf;
+
+    PooledBuffer(BufferPool* pool, DBF& dbf, const uint64_t capacity) : pool(pool), dbf(dbf) {
+        if (pool) dbf.mem_buffer = pool->acquire(static_cast<size_t>(capacity) + 1);
+    }
+    ~PooledBuffer() {
+        if (pool) pool->release(std::move(dbf.mem_buffer));
+    }
+};
+
+/**
+ * @brief Writes a loaded DBF as Parquet, removing the partial output on failure.
+ *
+ * @param dbf The DBF file structure.
+ * @param output Path of the Parquet file.
+ * @param options Conversion options.
+ * @param rows If not null, receives the number of records written.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status write_dbf(const DBF& dbf, const std::string& output, const ConvertOptions& options, int64_t* rows) {
+    auto status = write_parquet(dbf, output, options);
+    if (!status.ok()) {
+        std::error_code ec;
+        fs::remove(output, ec);
+        return status;
+    }
+
+    if (rows) *rows = dbf_NumRows(dbf);
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Loads one DBC file and writes it as Parquet.
+ *
+ * The decompressed size is reserved in the memory budget first, which is
+ * what makes multi-file runs admit fewer files at a time when memory is
+ * short. If writing fails, the partial output file is removed so that a
+ * failed file is never mistaken for a converted one.
+ *
+ * @param input Path of the DBC file.
+ * @param output Path of the Parquet file.
+ * @param options Conversion options.
+ * @param rows If not null, receives the number of records written.
+ * @return arrow::Status OK on success.
+ */
+arrow::Status convert_file(const std::string& input, const std::string& output, const ConvertOptions& options,
+                           int64_t* rows) {
+    FILE* file = fopen(input.c_str(), "rb");
+    if (!file) return arrow::Status::IOError("Error opening input file: ", input);
+
+    // Wait for room in the memory budget before holding the decompressed buffer
+    const uint64_t estimated_size = dbc_estimated_size(file);
+    MemoryReservation reservation(options.memory_budget.get(), static_cast<int64_t>(estimated_size));
+
+    // Decompress DBC data
+    DBF dbf;
+    PooledBuffer buffer(options.buffer_pool.get(), dbf, estimated_size);
+    const bool loaded = dbc_load_dbf(file, dbf);
+    std::fclose(file);
+    if (!loaded) return arrow::Status::IOError("Error loading DBC data: ", input);
+
+    return write_dbf(dbf, output, options, rows);
+}
+
+/**
+ * @brief Checks whether a path component holds '*' or '?' wildcards.
+ */
+static bool has_wildcard(const std::string& text) {
+    return text.find_first_of("*?") != std::string::npos;
+}
+
+/**
+ * @brief Matches a file name against a pattern with '*' and '?' wildcards.
+ *
+ * @param pattern The pattern of one path component.
+ * @param name The file name.
+ * @return bool true if the whole name matches.
+ */
+static bool wildcard_match(const char* pattern, const char* name) {
+    const char* star = nullptr;
+    const char* resume = nullptr;
+
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?' || *pattern == *name) {
+            pattern++;
+            name++;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+
+    return *pattern == '\0';
+}
+
+/**
+ * @brief Expands a path whose components may hold wildcards.
+ *
+ * Each component is matched against the entries of the directories matched
+ * so far, so patterns like "SIH/20??/RD??23*.dbc" are supported.
+ *
+ * @param pattern The path pattern.
+ * @param matches Receives the existing paths that match, sorted.
+ */
+static void expand_pattern(const fs::path& pattern, std::vector<fs::path>& matches) {
+    std::vector<fs::path> candidates{pattern.root_path()};
+
+    for (const auto& part : pattern.relative_path()) {
+        const std::string text = part.string();
+        std::vector<fs::path> next;
+
+        for (const auto& base : candidates) {
+            if (!has_wildcard(text)) {
+                next.push_back(base / part);
+                continue;
+            }
+
+            std::error_code ec;
+            const fs::path dir = base.empty() ? fs::path(".") : base;
+            for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+                const std::string name = it->path().filename().string();
+                if (wildcard_match(text.c_str(), name.c_str())) next.push_back(base / name);
+            }
+        }
+        candidates = std::move(next);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto& candidate : candidates) {
+        std::error_code ec;
+        if (fs::exists(candidate, ec)) matches.push_back(candidate);
+    }
+}
+
+/**
+ * @brief Checks whether a path has the .dbc extension, in any case.
+ */
+bool is_dbc_path(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".dbc";
+}
+
+/*! Accumulates jobs, skipping repeated inputs and rejecting output clashes. */
+struct JobCollector {
+    std::string output_dir;
+    std::string extension;
+    std::vector<ConvertJob> jobs;
+    std::set<std::string> inputs;
+    std::map<std::string, std::string> outputs;
+
+    /**
+     * @brief Adds one input file.
+     *
+     * @param input Path of the DBC file.
+     * @param relative Path of the output below output_dir, before the extension change.
+     */
+    arrow::Status add(const fs::path& input, const fs::path& relative) {
+        std::error_code ec;
+        fs::path key = fs::weakly_canonical(input, ec);
+        if (ec) key = input;
+        if (!inputs.insert(key.string()).second) return arrow::Status::OK();
+
+        ConvertJob job;
+        job.input = input.string();
+        job.output = generate_output_filename(output_dir.empty() ? job.input : (fs::path(output_dir) / relative).string(), extension);
+
+        auto [it, inserted] = outputs.emplace(job.output, job.input);
+        if (!inserted)
+            return arrow::Status::Invalid("Both ", it->second, " and ", job.input, " would be written to ", job.output);
+
+        if (FILE* file = fopen(job.input.c_str(), "rb")) {
+            job.estimated_size = dbc_estimated_size(file);
+            std::fclose(file);
+        }
+        const auto file_size = fs::file_size(input, ec);
+        if (!ec) job.file_size = file_size;
+
+        jobs.push_back(std::move(job));
+        return arrow::Status::OK();
+    }
+
+    /**
+     * @brief Adds every *.dbc file below a directory, keeping the subdirectory layout in the output.
+     */
+    arrow::Status add_directory(const fs::path& dir) {
+        std::vector<fs::path> files;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && is_dbc_path(it->path())) files.push_back(it->path());
+        }
+        if (ec) return arrow::Status::IOError("Cannot read directory ", dir.string(), ": ", ec.message());
+
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            ARROW_RETURN_NOT_OK(add(file, file.lexically_relative(dir)));
+        }
+        return arrow::Status::OK();
+    }
+
+    /**
+     * @brief Adds a file, directory or wildcard pattern.
+     *
+     * A plain path that does not exist is still added, so that it shows up as
+     * a failed file in the summary instead of being silently dropped.
+     */
+    arrow::Status add_argument(const std::string& argument) {
+        std::vector<fs::path> paths;
+        if (has_wildcard(argument)) {
+            expand_pattern(argument, paths);
+        } else {
+            paths.emplace_back(argument);
+        }
+
+        for (const auto& path : paths) {
+            std::error_code ec;
+            if (fs::is_directory(path, ec)) {
+                ARROW_RETURN_NOT_OK(add_directory(path));
+            } else {
+                ARROW_RETURN_NOT_OK(add(path, path.filename()));
+            }
+        }
+        return arrow::Status::OK();
+    }
+};
+
+/**
+ * @brief Expands files, directories, wildcard patterns and file lists into conversion jobs.
+ *
+ * Without an output directory, each Parquet file is written next to its DBC
+ * file. With one, files found in a directory keep their path relative to it
+ * and everything else is written directly into the output directory.
+ *
+ * @param inputs Files, directories or wildcard patterns.
+ * @param file_list Optional text file with one input per line.
+ * @param output_dir Optional output directory.
+ * @param extension Extension of the output files, with the dot.
+ * @return std::vector<ConvertJob> The jobs, in discovery order.
+ */
+arrow::Result<std::vector<ConvertJob>> collect_jobs(const std::vector<std::string>& inputs,
+                                                    const std::string& file_list, const std::string& output_dir,
+                                                    const std::string& extension) {
+    JobCollector collector;
+    collector.output_dir = output_dir;
+    collector.extension = extension;
+
+    for (const auto& input : inputs) {
+        ARROW_RETURN_NOT_OK(collector.add_argument(input));
+    }
+
+    if (!file_list.empty()) {
+        std::ifstream list(file_list);
+        if (!list) return arrow::Status::IOError("Cannot open file list: ", file_list);
+
+        std::string line;
+        while (std::getline(list, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            ARROW_RETURN_NOT_OK(collector.add_argument(line));
+        }
+    }
+
+    return std::move(collector.jobs);
+}
+
+/**
+ * @brief Keeps the jobs that belong to one shard of a run split across nodes.
+ *
+ * Every node computes the same partition from the same job list, without
+ * talking to the others: jobs are ordered by size (largest first, ties by
+ * path) and each is given to the shard with the least total size so far,
+ * the lowest-numbered one on ties. The size is the decompressed size from
+ * the DBC header, or the file size when the header could not be read.
+ *
+ * @param jobs All jobs of the run; must be the same list on every node.
+ * @param shard The shard to keep, from 0 to shards - 1.
+ * @param shards Number of shards.
+ * @return std::vector<ConvertJob> The jobs of this shard.
+ */
+std::vector<ConvertJob> select_shard(std::vector<ConvertJob> jobs, const int shard, const int shards) {
+    auto weight = [](const ConvertJob& job) { return job.estimated_size > 0 ? job.estimated_size : job.file_size; };
+    std::sort(jobs.begin(), jobs.end(), [&](const ConvertJob& a, const ConvertJob& b) {
+        if (weight(a) != weight(b)) return weight(a) > weight(b);
+        return a.input < b.input;
+    });
+
+    std::vector<uint64_t> load(static_cast<size_t>(std::max(shards, 1)), 0);
+    std::vector<ConvertJob> selected;
+    for (auto& job : jobs) {
+        const size_t target = static_cast<size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+        load[target] += std::max<uint64_t>(weight(job), 1);
+        if (static_cast<int>(target) == shard) selected.push_back(std::move(job));
+    }
+
+    return selected;
+}
+
+/**
+ * @brief Records the outputs and failures of a run as JSON.
+ *
+ * The manifest is written to a temporary file and renamed into place, so a
+ * reader on the shared filesystem never sees a partial one.
+ *
+ * @param path Path of the manifest.
+ * @param shard This node's shard, 0-based.
+ * @param shards Number of shards.
+ * @param results Outcome of every file of the shard.
+ * @return arrow::Status OK on success.
+ */
+arrow::Status write_manifest(const std::string& path, const int shard, const int shards,
+                             const std::vector<ConvertResult>& results) {
+    std::vector<const ConvertResult*> sorted;
+    size_t failed = 0;
+    int64_t rows = 0;
+    for (const auto& result : results) {
+        sorted.push_back(&result);
+        if (result.status.ok()) rows += result.rows;
+        else failed++;
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const ConvertResult* a, const ConvertResult* b) { return a->job.input < b->job.input; });
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"shard\": " << shard << ",\n";
+    json << "  \"shards\": " << shards << ",\n";
+    json << "  \"converted\": " << (results.size() - failed) << ",\n";
+    json << "  \"failed\": " << failed << ",\n";
+    json << "  \"rows\": " << rows << ",\n";
+    json << "  \"files\": [";
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const ConvertResult& result = *sorted[i];
+        json << (i ? ",\n" : "\n") << "    {\"input\": " << json_quote(result.job.input)
+             << ", \"output\": " << json_quote(result.job.output)
+             << ", \"estimated_bytes\": " << result.job.estimated_size;
+        if (result.status.ok()) {
+            json << ", \"status\": \"ok\", \"rows\": " << result.rows << ", \"seconds\": " << result.seconds << "}";
+        } else {
+            json << ", \"status\": \"failed\", \"error\": " << json_quote(result.status.ToString()) << "}";
+        }
+    }
+    json << (sorted.empty() ? "]\n" : "\n  ]\n") << "}\n";
+
+    std::error_code ec;
+    const fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) fs::create_directories(parent, ec);
+
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) return arrow::Status::IOError("Cannot write manifest: ", temp_path);
+        file << json.str();
+        if (!file.flush()) return arrow::Status::IOError("Cannot write manifest: ", temp_path);
+    }
+
+    fs::rename(temp_path, path, ec);
+    if (ec) return arrow::Status::IOError("Cannot write manifest ", path, ": ", ec.message());
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Converts a file whose bytes were read ahead by a SmallFileReader.
+ *
+ * The buffer slot is handed back as soon as the DBF is decompressed, so the
+ * reader can move on while this file is being written. The memory budget is
+ * only charged once the slot is taken: a worker never holds budget while it
+ * waits for the reader, and a file that did not fit its slot is converted
+ * normally, which takes its own reservation.
+ */
+static arrow::Status convert_prefetched(const ConvertJob& job, SmallFileReader& reader, const size_t index,
+                                        const ConvertOptions& options, int64_t* rows) {
+    ARROW_ASSIGN_OR_RAISE(const PrefetchedFile file, reader.take(index));
+    if (!file.data) return convert_file(job.input, job.output, options, rows);
+
+    MemoryReservation reservation(options.memory_budget.get(), static_cast<int64_t>(job.estimated_size));
+
+    DBF dbf;
+    PooledBuffer buffer(options.buffer_pool.get(), dbf, job.estimated_size);
+    bool loaded = false;
+    try {
+        loaded = dbc_load_dbf_from_memory(file.data, file.size, dbf);
+    } catch (...) {
+        reader.release(file);
+        throw;
+    }
+    reader.release(file);
+    if (!loaded) return arrow::Status::IOError("Error loading DBC data: ", job.input);
+
+    return write_dbf(dbf, job.output, options, rows);
+}
+
+/**
+ * @brief Converts one job, turning any exception into a failed status.
+ *
+ * @param reader Read-ahead of the small files, or nullptr.
+ * @param small_index Position of the job in the reader, or -1 to read it normally.
+ */
+static arrow::Status run_job(const ConvertJob& job, const ConvertOptions& options, SmallFileReader* reader,
+                             const int64_t small_index, int64_t* rows) {
+    try {
+        const fs::path parent = fs::path(job.output).parent_path();
+        if (!parent.empty()) {
+            std::error_code ec;
+            fs::create_directories(parent, ec);
+            if (ec) return arrow::Status::IOError("Cannot create directory ", parent.string(), ": ", ec.message());
+        }
+        if (reader && small_index >= 0)
+            return convert_prefetched(job, *reader, static_cast<size_t>(small_index), options, rows);
+        return convert_file(job.input, job.output, options, rows);
+    } catch (const std::exception& e) {
+        return arrow::Status::UnknownError(job.input, ": ", e.what());
+    }
+}
+
+/**
+ * @brief Converts many files on a pool of threads, largest first.
+ *
+ * Jobs are sorted by estimated size and each thread claims the next
+ * unclaimed one when it becomes free, so the biggest files start first and
+ * the many small ones fill in around them. Each file still decodes its
+ * batches on the shared Arrow CPU pool. Files of at most
+ * SmallFileReader::kMaxFileSize bytes are read ahead in batches, in the
+ * order they will be claimed, while the larger ones are converted.
+ *
+ * @param jobs The files to convert.
+ * @param options Conversion options, shared by all files.
+ * @param parallel_jobs Number of files converted at the same time.
+ * @param on_done Optional callback run after each file, one call at a time.
+ * @return std::vector<ConvertResult> One result per job, in scheduling order.
+ */
+std::vector<ConvertResult> convert_files(std::vector<ConvertJob> jobs, const ConvertOptions& options, int parallel_jobs,
+                                         const std::function<void(const ConvertResult&)>& on_done) {
+    std::stable_sort(jobs.begin(), jobs.end(),
+                     [](const ConvertJob& a, const ConvertJob& b) { return a.estimated_size > b.estimated_size; });
+
+    const size_t threads = std::min(jobs.size(), static_cast<size_t>(std::max(parallel_jobs, 1)));
+
+    std::vector<std::string> small_paths;
+    std::vector<uint64_t> small_sizes;
+    std::vector<int64_t> small_index(jobs.size(), -1);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].file_size > 0 && jobs[i].file_size <= SmallFileReader::kMaxFileSize) {
+            small_index[i] = static_cast<int64_t>(small_paths.size());
+            small_paths.push_back(jobs[i].input);
+            small_sizes.push_back(jobs[i].file_size);
+        }
+    }
+
+    // Two slots per thread keep the next file ready while the current one decompresses.
+    std::unique_ptr<SmallFileReader> reader;
+    MemoryBudget* budget = options.memory_budget.get();
+    if (small_paths.size() > 1) {
+        const int slots = static_cast<int>(std::min<size_t>({2 * threads + 8, 64, small_paths.size()}));
+        reader = std::make_unique<SmallFileReader>(std::move(small_paths), std::move(small_sizes), slots);
+        if (budget) budget->add(static_cast<int64_t>(reader->arena_size()));
+    }
+
+    std::vector<ConvertResult> results(jobs.size());
+    std::atomic<size_t> next{0};
+    std::mutex done_mutex;
+
+    auto worker = [&] {
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            ConvertResult& result = results[i];
+            result.job = std::move(jobs[i]);
+
+            const auto start = std::chrono::steady_clock::now();
+            result.status = run_job(result.job, options, reader.get(), small_index[i], &result.rows);
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (on_done) {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                on_done(result);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+
+    if (reader && budget) budget->remove(static_cast<int64_t>(reader->arena_size()));
+
+    return results;
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * batch_convert.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for batch_convert.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef BATCH_CONVERT_H
+#define BATCH_CONVERT_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+#include <arrow/result.h>
+#include <arrow/status.h>
+#include "parquet_write.hpp"
+
+/*! \struct ConvertJob
+	\brief One input file of a multi-file run
+*/
+struct ConvertJob {
+    /*! DBC file to read */
+    std::string input;
+    /*! Parquet file to write */
+    std::string output;
+    /*! decompressed size announced by the DBC header, used for scheduling */
+    uint64_t estimated_size = 0;
+    /*! size of the DBC file on disk */
+    uint64_t file_size = 0;
+};
+
+/*! \struct ConvertResult
+	\brief Outcome of one file of a multi-file run
+*/
+struct ConvertResult {
+    ConvertJob job;
+    /*! OK, or why this file failed; other files are not affected */
+    arrow::Status status;
+    /*! records written */
+    int64_t rows = 0;
+    /*! wall time spent on this file */
+    double seconds = 0;
+};
+
+/* generate_output_filename()
+ * Replaces the extension of a DBC path with ".parquet", or the given one.
+ */
+std::string generate_output_filename(const std::string& input_file, const std::string& extension = ".parquet");
+
+/* is_dbc_path()
+ * Checks whether a path has the .dbc extension, in any case.
+ */
+bool is_dbc_path(const std::filesystem::path& path);
+
+/* convert_file()
+ * Loads one DBC file and writes it as Parquet; a partial output is removed on failure.
+ */
+arrow::Status convert_file(const std::string& input, const std::string& output, const ConvertOptions& options,
+                           int64_t* rows = nullptr);
+
+/* collect_jobs()
+ * Expands files, directories, wildcard patterns and file lists into conversion jobs.
+ */
+arrow::Result<std::vector<ConvertJob>> collect_jobs(const std::vector<std::string>& inputs,
+                                                    const std::string& file_list, const std::string& output_dir,
+                                                    const std::string& extension = ".parquet");
+
+/* select_shard()
+ * Keeps the jobs of shard `shard` (0-based) out of `shards`, balanced by size.
+ */
+std::vector<ConvertJob> select_shard(std::vector<ConvertJob> jobs, int shard, int shards);
+
+/* write_manifest()
+ * Records the outputs and failures of a run as JSON.
+ */
+arrow::Status write_manifest(const std::string& path, int shard, int shards, const std::vector<ConvertResult>& results);
+
+/* convert_files()
+ * Converts many files on a pool of threads, largest first.
+ */
+std::vector<ConvertResult> convert_files(std::vector<ConvertJob> jobs, const ConvertOptions& options, int parallel_jobs,
+                                         const std::function<void(const ConvertResult&)>& on_done = nullptr);
+
+#endif
@@ -0,0 +1,525 @@
+/*****************************************************************************
+ * @file daemon.cpp
+ * @brief Conversion service on a Unix domain socket (--daemon).
+ *
+ * Spawning the converter once per file pays for process start, Arrow and
+ * Parquet static initialization and thread pool creation every time. The
+ * daemon pays for them once: the CPU thread pool, the iconv descriptors and
+ * the decompression buffers stay warm between requests.
+ *
+ * The protocol is one JSON object per line in each direction. A request
+ *
+ *     {"id": 7, "input": "RDSP2301.dbc", "output": "out/RDSP2301.parquet",
+ *      "options": {"infer_types": true}}
+ *
+ * is answered, once the file is written, with
+ *
+ *     {"id": 7, "ok": true, "input": "...", "output": "...", "rows": 123,
+ *      "seconds": 0.41, "input_bytes": ..., "output_bytes": ..., "memory_in_use": ...}
+ *
+ * or {"id": 7, "ok": false, "error": "..."}. "command" may also be "ping",
+ * "stats" or "shutdown". Each connection is served by its own thread and
+ * its requests are answered in order; at most --jobs conversions run at
+ * once, across all connections, and the others wait for their turn.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include "daemon.hpp"
+
+#ifdef _WIN32
+
+arrow::Status run_daemon(const std::string&, const ConvertOptions&, int) {
+    return arrow::Status::NotImplemented("--daemon needs Unix domain sockets");
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <arrow/memory_pool.h>
+#include <arrow/util/thread_pool.h>
+#include "batch_convert.hpp"
+#include "json.hpp"
+#include "schema_file.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace fs = std::filesystem;
+
+/*! longest request line accepted */
+static constexpr size_t kMaxRequestLine = 1 << 20;
+
+static std::atomic<bool> g_stop{false};
+
+static void on_stop_signal(int) {
+    g_stop = true;
+}
+
+/*! \struct DaemonStats
+	\brief Totals reported by the "stats" command
+*/
+struct DaemonStats {
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<int64_t> jobs{0};
+    std::atomic<int64_t> failed{0};
+    std::atomic<int64_t> rows{0};
+    std::atomic<int64_t> active_connections{0};
+    /*! conversions waiting for a free job */
+    std::atomic<int64_t> queued{0};
+};
+
+/*! \class JobSlots
+	\brief Limits the conversions running at once, across all connections
+*/
+class JobSlots {
+public:
+    explicit JobSlots(const int slots) : free_(std::max(slots, 1)) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return free_ > 0; });
+        free_--;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_++;
+        }
+        cv_.notify_one();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int free_;
+};
+
+/*! Holds one of the JobSlots for its lifetime. */
+struct JobSlot {
+    explicit JobSlot(JobSlots& slots) : slots(slots) { slots.acquire(); }
+    ~JobSlot() { slots.release(); }
+    JobSlot(const JobSlot&) = delete;
+    JobSlot& operator=(const JobSlot&) = delete;
+    JobSlots& slots;
+};
+
+/*! One client, served by its own thread. */
+struct Connection {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> done{false};
+};
+
+/**
+ * @brief Formats a number for a JSON response, without a fraction when integral.
+ */
+static std::string json_number(const double value) {
+    std::ostringstream out;
+    if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 9e15)
+        out << static_cast<int64_t>(value);
+    else
+        out << value;
+    return out.str();
+}
+
+/**
+ * @brief Echoes the request id, if any, as the first member of a response.
+ */
+static std::string response_head(const JsonValue* request) {
+    const JsonValue* id = request ? request->find("id") : nullptr;
+    if (!id) return "{";
+    if (id->is_string()) return "{\"id\":" + json_quote(id->string) + ",";
+    if (id->is_number()) return "{\"id\":" + json_number(id->number) + ",";
+    return "{";
+}
+
+static std::string error_response(const JsonValue* request, const std::string& message) {
+    return response_head(request) + "\"ok\":false,\"error\":" + json_quote(message) + "}";
+}
+
+/**
+ * @brief Bytes currently held by conversions.
+ */
+static int64_t memory_in_use(const ConvertOptions& options) {
+    if (options.memory_budget) return options.memory_budget->used();
+    return arrow::default_memory_pool()->bytes_allocated();
+}
+
+/**
+ * @brief Applies the "options" member of a request on top of the daemon's defaults.
+ */
+static arrow::Result<ConvertOptions> request_options(const JsonValue& request, const ConvertOptions& defaults) {
+    ConvertOptions options = defaults;
+    const JsonValue* overrides = request.find("options");
+    if (!overrides) return options;
+    if (!overrides->is_object()) return arrow::Status::Invalid("\"options\" must be an object");
+
+    for (const auto& [key, value] : overrides->object) {
+        if (key == "infer_types") {
+            if (!value.is_bool()) return arrow::Status::Invalid("\"infer_types\" must be a boolean");
+            options.infer_types = value.boolean;
+        } else if (key == "adaptive_encoding") {
+            if (!value.is_bool()) return arrow::Status::Invalid("\"adaptive_encoding\" must be a boolean");
+            options.adaptive_encoding = value.boolean;
+        } else if (key == "content_defined_chunking") {
+            if (!value.is_bool()) return arrow::Status::Invalid("\"content_defined_chunking\" must be a boolean");
+            options.content_defined_chunking = value.boolean;
+        } else if (key == "cdc_norm_level") {
+            if (!value.is_number() || value.number < -8 || value.number > 8)
+                return arrow::Status::Invalid("\"cdc_norm_level\" must be between -8 and 8");
+            options.cdc_norm_level = static_cast<int>(value.number);
+        } else if (key == "schema_file") {
+            if (!value.is_string()) return arrow::Status::Invalid("\"schema_file\" must be a string");
+            ARROW_ASSIGN_OR_RAISE(options.schema_overrides, load_schema_file(value.string));
+        } else if (key == "batch_size" || key == "workers" || key == "queue_depth" || key == "partition_writers") {
+            if (!value.is_number() || value.number < 0 || value.number > 1e9)
+                return arrow::Status::Invalid("\"", key, "\" must be a non-negative integer");
+            const int number = static_cast<int>(value.number);
+            if (key == "batch_size") options.batch_size = number > 0 ? number : defaults.batch_size;
+            else if (key == "workers") options.workers = number > 0 ? number : 1;
+            else if (key == "partition_writers") options.partition_writers = number > 0 ? number : 1;
+            else options.queue_depth = number;
+        } else if (key == "format") {
+            if (!value.is_string()) return arrow::Status::Invalid("\"format\" must be a string");
+            ARROW_RETURN_NOT_OK(parse_output_format(value.string, options));
+        } else if (key == "compression") {
+            if (!value.is_string()) return arrow::Status::Invalid("\"compression\" must be a string");
+            ARROW_ASSIGN_OR_RAISE(options.compression, parse_compression(value.string));
+            if (options.compression.codec.empty()) options.compression.codec = "zstd";
+        } else if (key == "column_compression") {
+            if (!value.is_object()) return arrow::Status::Invalid("\"column_compression\" must be an object");
+            for (const auto& [column, setting] : value.object) {
+                if (!setting.is_string())
+                    return arrow::Status::Invalid("\"column_compression\" values must be strings");
+                ARROW_ASSIGN_OR_RAISE(options.column_compression[column], parse_compression(setting.string));
+            }
+        } else if (key == "bloom_filter_columns" || key == "page_index_columns" || key == "partition_by") {
+            if (!value.is_array()) return arrow::Status::Invalid("\"", key, "\" must be an array of column names");
+            auto& columns = key == "bloom_filter_columns" ? options.bloom_filter_columns
+                            : key == "page_index_columns" ? options.page_index_columns
+                                                          : options.partition_by;
+            columns.clear();
+            for (const auto& column : value.array) {
+                if (!column.is_string()) return arrow::Status::Invalid("\"", key, "\" must be an array of column names");
+                columns.push_back(column.string);
+            }
+        } else if (key == "bloom_filter_fpp") {
+            if (!value.is_number() || value.number <= 0 || value.number >= 1)
+                return arrow::Status::Invalid("\"bloom_filter_fpp\" must be between 0 and 1");
+            options.bloom_filter_fpp = value.number;
+        } else if (key == "sorting_columns") {
+            if (!value.is_string()) return arrow::Status::Invalid("\"sorting_columns\" must be a string");
+            ARROW_ASSIGN_OR_RAISE(options.sorting_columns, parse_sort_keys(value.string));
+        } else if (key == "sort_by") {
+            if (!value.is_string()) return arrow::Status::Invalid("\"sort_by\" must be a string");
+            ARROW_ASSIGN_OR_RAISE(options.sort_by, parse_sort_keys(value.string));
+        } else if (key == "row_group_rows" || key == "row_group_bytes" || key == "page_size" ||
+                   key == "dictionary_page_limit" || key == "bloom_filter_ndv" || key == "max_file_bytes" ||
+                   key == "max_file_rows" || key == "cdc_min_chunk_size" || key == "cdc_max_chunk_size") {
+            if (!value.is_number() || value.number < 0)
+                return arrow::Status::Invalid("\"", key, "\" must be a non-negative integer");
+            const auto number = static_cast<int64_t>(value.number);
+            if (key == "row_group_rows") options.row_group_rows = number;
+            else if (key == "row_group_bytes") options.row_group_bytes = number;
+            else if (key == "page_size") options.page_size = number;
+            else if (key == "bloom_filter_ndv") options.bloom_filter_ndv = number;
+            else if (key == "max_file_bytes") options.max_file_bytes = number;
+            else if (key == "max_file_rows") options.max_file_rows = number;
+            else if (key == "cdc_min_chunk_size") options.cdc_min_chunk_size = number;
+            else if (key == "cdc_max_chunk_size") options.cdc_max_chunk_size = number;
+            else options.dictionary_page_limit = number;
+        } else {
+            return arrow::Status::Invalid("unknown option \"", key, "\"");
+        }
+    }
+    return options;
+}
+
+/**
+ * @brief Runs a "convert" request and describes the outcome.
+ */
+static std::string handle_convert(const JsonValue& request, const ConvertOptions& defaults, DaemonStats& stats,
+                                  JobSlots& slots) {
+    const JsonValue* input = request.find("input");
+    if (!input || !input->is_string() || input->string.empty())
+        return error_response(&request, "\"input\" must be a non-empty string");
+
+    auto options = request_options(request, defaults);
+    if (!options.ok()) return error_response(&request, options.status().ToString());
+
+    std::string output;
+    if (const JsonValue* value = request.find("output")) {
+        if (!value->is_string() || value->string.empty())
+            return error_response(&request, "\"output\" must be a non-empty string");
+        output = value->string;
+    } else {
+        output = generate_output_filename(input->string, options->output_extension());
+    }
+
+    stats.queued++;
+    const JobSlot slot(slots);
+    stats.queued--;
+
+    const auto start = std::chrono::steady_clock::now();
+    int64_t rows = 0;
+    arrow::Status status;
+    try {
+        const fs::path parent = fs::path(output).parent_path();
+        if (!parent.empty()) fs::create_directories(parent);
+        status = convert_file(input->string, output, *options, &rows);
+    } catch (const std::exception& e) {
+        status = arrow::Status::UnknownError(e.what());
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stats.jobs++;
+    if (!status.ok()) {
+        stats.failed++;
+        std::cerr << (input->string + " FAILED: " + status.ToString() + "\n");
+        return error_response(&request, status.ToString());
+    }
+    stats.rows += rows;
+    std::ostringstream log;
+    log << input->string << " -> " << output << " (" << rows << " rows, " << seconds << " s)\n";
+    std::cout << log.str();
+
+    std::error_code input_error, output_error;
+    const auto input_bytes = fs::file_size(input->string, input_error);
+    const auto output_bytes = fs::file_size(output, output_error);
+
+    std::ostringstream out;
+    out << response_head(&request) << "\"ok\":true"
+        << ",\"input\":" << json_quote(input->string)
+        << ",\"output\":" << json_quote(output)
+        << ",\"rows\":" << rows
+        << ",\"seconds\":" << seconds
+        << ",\"input_bytes\":" << (input_error ? 0 : input_bytes)
+        << ",\"output_bytes\":" << (output_error ? 0 : output_bytes)
+        << ",\"memory_in_use\":" << memory_in_use(*options) << "}";
+    return out.str();
+}
+
+/**
+ * @brief Answers one request line.
+ */
+static std::string handle_request(const std::string& line, const ConvertOptions& defaults, DaemonStats& stats,
+                                  JobSlots& slots) {
+    auto parsed = json_parse(line);
+    if (!parsed.ok()) return error_response(nullptr, parsed.status().ToString());
+    const JsonValue& request = *parsed;
+    if (!request.is_object()) return error_response(nullptr, "request must be a JSON object");
+
+    std::string command = "convert";
+    if (const JsonValue* value = request.find("command")) {
+        if (!value->is_string()) return error_response(&request, "\"command\" must be a string");
+        command = value->string;
+    }
+
+    if (command == "convert") return handle_convert(request, defaults, stats, slots);
+    if (command == "ping") return response_head(&request) + "\"ok\":true}";
+    if (command == "shutdown") {
+        g_stop = true;
+        return response_head(&request) + "\"ok\":true}";
+    }
+    if (command == "stats") {
+        const double uptime =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - stats.started).count();
+        std::ostringstream out;
+        out << response_head(&request) << "\"ok\":true"
+            << ",\"uptime\":" << uptime
+            << ",\"jobs\":" << stats.jobs.load()
+            << ",\"failed\":" << stats.failed.load()
+            << ",\"rows\":" << stats.rows.load()
+            << ",\"connections\":" << stats.active_connections.load()
+            << ",\"queued\":" << stats.queued.load()
+            << ",\"threads\":" << arrow::GetCpuThreadPoolCapacity()
+            << ",\"memory_in_use\":" << memory_in_use(defaults);
+        if (defaults.memory_budget)
+            out << ",\"memory_peak\":" << defaults.memory_budget->peak()
+                << ",\"memory_limit\":" << defaults.memory_budget->limit();
+        out << "}";
+        return out.str();
+    }
+    return error_response(&request, "unknown command \"" + command + "\"");
+}
+
+/**
+ * @brief Sends a whole buffer, retrying short writes.
+ */
+static bool send_all(const int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads request lines from a client and answers each in turn.
+ */
+static void serve_connection(Connection& connection, const ConvertOptions& defaults, DaemonStats& stats,
+                             JobSlots& slots) {
+    std::string pending;
+    char chunk[64 * 1024];
+
+    while (true) {
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.find_first_not_of(" \t") == std::string::npos) continue;
+            if (!send_all(connection.fd, handle_request(line, defaults, stats, slots) + "\n")) return;
+        }
+        if (pending.size() > kMaxRequestLine) {
+            send_all(connection.fd, error_response(nullptr, "request line too long") + "\n");
+            return;
+        }
+
+        const ssize_t n = recv(connection.fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        pending.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+/**
+ * @brief Creates the listening socket, replacing a stale socket file.
+ *
+ * The socket is only accessible to its owner: any client may have files
+ * read and written with the daemon's permissions.
+ */
+static arrow::Result<int> open_listener(const std::string& socket_path) {
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return arrow::Status::Invalid("socket path too long: ", socket_path);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    struct stat st{};
+    if (lstat(socket_path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) return arrow::Status::IOError(socket_path, " exists and is not a socket");
+
+        // Refuse to take over the socket of a daemon that is still running
+        const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) return arrow::Status::IOError("another daemon is listening on ", socket_path);
+        unlink(socket_path.c_str());
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return arrow::Status::IOError("socket: ", std::strerror(errno));
+    // No client can connect before listen(), so the mode is set in between
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        chmod(socket_path.c_str(), S_IRUSR | S_IWUSR) != 0 || listen(fd, 64) != 0) {
+        const int error = errno;
+        close(fd);
+        return arrow::Status::IOError("cannot listen on ", socket_path, ": ", std::strerror(error));
+    }
+    return fd;
+}
+
+/**
+ * @brief Serves conversion requests until stopped.
+ *
+ * @param socket_path Path of the Unix domain socket to create.
+ * @param defaults Options of every conversion, before the request's own.
+ * @param parallel_jobs Number of files converted at the same time.
+ * @return arrow::Status OK after a clean shutdown.
+ */
+arrow::Status run_daemon(const std::string& socket_path, const ConvertOptions& defaults, const int parallel_jobs) {
+    ARROW_ASSIGN_OR_RAISE(const int listener, open_listener(socket_path));
+
+    g_stop = false;
+    std::signal(SIGPIPE, SIG_IGN);
+    struct sigaction action{};
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Listening on " << socket_path << " (" << std::max(parallel_jobs, 1) << " at a time)\n"
+              << std::flush;
+
+    DaemonStats stats;
+    JobSlots slots(parallel_jobs);
+    std::list<std::unique_ptr<Connection>> connections;
+
+    while (!g_stop) {
+        // Reap the threads of clients that hung up
+        for (auto it = connections.begin(); it != connections.end();) {
+            if ((*it)->done) {
+                (*it)->thread.join();
+                close((*it)->fd);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        pollfd pfd{listener, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) continue;
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        Connection* raw = connection.get();
+        stats.active_connections++;
+        raw->thread = std::thread([raw, &defaults, &stats, &slots] {
+            serve_connection(*raw, defaults, stats, slots);
+            stats.active_connections--;
+            raw->done = true;
+        });
+        connections.push_back(std::move(connection));
+    }
+
+    close(listener);
+    unlink(socket_path.c_str());
+
+    // Let conversions in progress finish, but stop waiting for new requests
+    for (auto& connection : connections) shutdown(connection->fd, SHUT_RD);
+    for (auto& connection : connections) {
+        connection->thread.join();
+        close(connection->fd);
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::cout << "Daemon stopped after " << stats.jobs.load() << " job(s), " << stats.failed.load()
+              << " failed\n";
+    return arrow::Status::OK();
+}
+
+#endif
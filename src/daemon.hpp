@@ -0,0 +1,27 @@
+/*****************************************************************************
+ * daemon.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for daemon.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <string>
+#include <arrow/status.h>
+#include "parquet_write.hpp"
+
+/* run_daemon()
+ * Serves conversion requests on a Unix domain socket until SIGINT, SIGTERM
+ * or a "shutdown" request, converting at most parallel_jobs files at once.
+ */
+arrow::Status run_daemon(const std::string& socket_path, const ConvertOptions& defaults, int parallel_jobs);
+
+#endif
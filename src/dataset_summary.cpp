@@ -0,0 +1,123 @@
+/*****************************************************************************
+ * @file dataset_summary.cpp
+ * @brief The _metadata and _common_metadata files of a dataset (--summary-metadata).
+ *
+ * `_metadata` holds the footers of every file of the dataset, their row
+ * groups appended one after the other with each column chunk pointing to
+ * its file by a path relative to the dataset root. `_common_metadata` holds
+ * only the schema and key-value metadata. Engines that find them (Arrow,
+ * Dask, DuckDB's parquet_metadata) plan a scan from one read instead of
+ * opening thousands of footers. Both are metadata-only Parquet files,
+ * written under a temporary name and renamed into place.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <arrow/io/file.h>
+#include <arrow/result.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/schema.h>
+#include "dataset_summary.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Records the footer of a finished file.
+ *
+ * @param path Path of the file, as written.
+ * @param footer Its metadata, from the writer once closed.
+ */
+void DatasetSummary::add(const std::string& path, std::shared_ptr<parquet::FileMetaData> footer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    footers_.push_back({path, std::move(footer)});
+}
+
+/**
+ * @brief Takes over the files of another summary, such as those of one
+ * conversion once all of it has succeeded.
+ */
+void DatasetSummary::add(DatasetSummary&& files) {
+    std::vector<Footer> taken;
+    {
+        std::lock_guard<std::mutex> lock(files.mutex_);
+        taken.swap(files.footers_);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& footer : taken) footers_.push_back(std::move(footer));
+}
+
+/**
+ * @brief Writes a metadata-only Parquet file through a temporary file.
+ */
+static arrow::Status write_metadata_file(const fs::path& path, const parquet::FileMetaData& metadata) {
+    const fs::path temp = path.parent_path() / ("." + path.filename().string() + ".tmp");
+    {
+        ARROW_ASSIGN_OR_RAISE(auto sink, arrow::io::FileOutputStream::Open(temp.string()));
+        auto status = parquet::arrow::WriteMetaDataFile(metadata, sink.get());
+        if (status.ok()) status = sink->Close();
+        if (!status.ok()) {
+            std::error_code ec;
+            (void)sink->Close();
+            fs::remove(temp, ec);
+            return status;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return arrow::Status::IOError("Cannot rename ", temp.string(), " to ", path.string());
+    }
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Writes `_metadata` and `_common_metadata` into the root directory.
+ *
+ * Files are listed by path, so the summary of a run does not depend on the
+ * order conversions finished in. Every file must have the same Parquet
+ * schema; a directory of files with different layouts has no summary.
+ *
+ * @return arrow::Status OK on success, or if no file was added.
+ */
+arrow::Status DatasetSummary::write() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (footers_.empty()) return arrow::Status::OK();
+
+    const fs::path root = fs::absolute(root_.empty() ? fs::path(".") : fs::path(root_)).lexically_normal();
+    std::vector<std::pair<std::string, const Footer*>> files;
+    for (const auto& footer : footers_) {
+        const std::string relative = fs::absolute(footer.path).lexically_normal().lexically_relative(root).generic_string();
+        if (relative.empty() || relative.rfind("..", 0) == 0)
+            return arrow::Status::Invalid(footer.path, " is outside the summary directory ", root_);
+        files.emplace_back(relative, &footer);
+    }
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const parquet::FileMetaData& first = *files.front().second->metadata;
+    std::vector<int> no_row_groups;
+    std::shared_ptr<parquet::FileMetaData> combined = first.Subset(no_row_groups);
+    for (const auto& [relative, footer] : files) {
+        if (!footer->metadata->schema()->Equals(*first.schema()))
+            return arrow::Status::Invalid("Cannot summarize ", files.front().second->path, " and ", footer->path,
+                                          " together: their schemas differ");
+        // Point the column chunks of a copy at the file; the caller's footer is left as written
+        std::vector<int> row_groups(footer->metadata->num_row_groups());
+        std::iota(row_groups.begin(), row_groups.end(), 0);
+        auto located = footer->metadata->Subset(row_groups);
+        located->set_file_path(relative);
+        combined->AppendRowGroups(*located);
+    }
+
+    ARROW_RETURN_NOT_OK(write_metadata_file(root / "_common_metadata", *first.Subset(no_row_groups)));
+    return write_metadata_file(root / "_metadata", *combined);
+}
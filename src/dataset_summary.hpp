@@ -0,0 +1,58 @@
+/*****************************************************************************
+ * dataset_summary.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for dataset_summary.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef DATASET_SUMMARY_H
+#define DATASET_SUMMARY_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <arrow/status.h>
+#include <parquet/metadata.h>
+
+/*! \class DatasetSummary
+	\brief Footers of the Parquet files written under one directory
+
+	Conversions add the footer of each file they finish; write() then
+	combines them into the `_metadata` and `_common_metadata` files of the
+	directory, so query planners read one footer instead of one per file.
+	add() may be called from several threads.
+*/
+class DatasetSummary {
+public:
+    /*! root: directory the summary files go to, and that file paths are relative to */
+    explicit DatasetSummary(std::string root) : root_(std::move(root)) {}
+
+    const std::string& root() const { return root_; }
+
+    void add(const std::string& path, std::shared_ptr<parquet::FileMetaData> footer);
+    void add(DatasetSummary&& files);
+
+    arrow::Status write();
+
+private:
+    /*! \struct Footer
+    	\brief A written file and its footer
+    */
+    struct Footer {
+        std::string path;
+        std::shared_ptr<parquet::FileMetaData> metadata;
+    };
+
+    const std::string root_;
+    std::mutex mutex_;
+    std::vector<Footer> footers_;
+};
+
+#endif
@@ -28,6 +28,7 @@
 
 #include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <cstring>
 #include <vector>
@@ -151,8 +152,8 @@ static int dbf_ReadFieldInfo(DBF& dbf) {
  * @param row The row index of the record.
  * @return std::string The trimmed value of the field.
  */
-std::string dbf_get_field_value(const DBF& dbf, const int col, const int row) {
-    const size_t record_offset = dbf.header->header_length + (row * dbf.header->record_length);
+std::string dbf_get_field_value(const DBF& dbf, const int col, const int64_t row) {
+    const size_t record_offset = dbf.header->header_length + static_cast<size_t>(row) * dbf.header->record_length;
 
     const size_t field_offset = dbf.fields[col].field_offset;
 
@@ -167,6 +168,47 @@ std::string dbf_get_field_value(const DBF& dbf, const int col, const int row) {
     return value;
 }
 
+/**
+ * @brief Computes the decompressed DBF size announced by its header.
+ *
+ * The sum is done in 64 bits, since records * record_length exceeds 4 GB for
+ * the largest DATASUS files.
+ *
+ * @param header_bytes Buffer starting with the raw (little-endian) DB_HEADER.
+ * @return uint64_t header_length + records * record_length, or 0 if the buffer is too short.
+ */
+static uint64_t dbf_ExpectedSize(const std::vector<unsigned char>& header_bytes) {
+    if (header_bytes.size() < 12) return 0;
+    const unsigned char* h = header_bytes.data();
+
+    const uint64_t records = static_cast<uint64_t>(h[4]) | (static_cast<uint64_t>(h[5]) << 8) |
+                             (static_cast<uint64_t>(h[6]) << 16) | (static_cast<uint64_t>(h[7]) << 24);
+    const uint64_t header_length = h[8] | (h[9] << 8);
+    const uint64_t record_length = h[10] | (h[11] << 8);
+
+    return header_length + records * record_length;
+}
+
+/**
+ * @brief Estimates the decompressed DBF size of a DBC file from its header.
+ *
+ * The DBC header is a copy of the DBF header, so the size is known without
+ * decompressing anything. The file position is restored afterwards.
+ *
+ * @param input The input file stream.
+ * @return uint64_t header_length + records * record_length, or 0 on error.
+ */
+uint64_t dbc_estimated_size(FILE* input) {
+    const long position = ftell(input);
+    std::vector<unsigned char> header_bytes(12);
+
+    if (fseek(input, 0, SEEK_SET) != 0) return 0;
+    const size_t read_bytes = fread(header_bytes.data(), 1, header_bytes.size(), input);
+    fseek(input, position, SEEK_SET);
+
+    return read_bytes == header_bytes.size() ? dbf_ExpectedSize(header_bytes) : 0;
+}
+
 /**
  * @brief Reads the header size from the DBF file.
  *
@@ -182,25 +224,55 @@ static uint16_t dbf_ReadHeaderSize(FILE* input) {
     return rawHeader[0] + (rawHeader[1] << 8);
 }
 
+/*! Read state of a DBC file being decompressed; one per call, so files can be loaded concurrently. */
+struct FileInput {
+    FILE* file;
+    unsigned char buffer[CHUNK];
+};
+
 /**
  * @brief Callback function for reading input from a file.
  *
- * @param how Pointer to the FILE object.
+ * @param how Pointer to the FileInput.
  * @param buf Pointer to the buffer where data will be stored.
  * @return unsigned The number of bytes read.
  */
 static unsigned in_from_file(void* how, unsigned char** buf) {
-    FILE* file = static_cast<FILE *>(how);
+    FileInput* input = static_cast<FileInput *>(how);
 
-    static unsigned char file_buffer[4096];
+    size_t read_bytes = std::fread(input->buffer, 1, sizeof(input->buffer), input->file);
 
-    size_t read_bytes = std::fread(file_buffer, 1, sizeof(file_buffer), file);
-
-    *buf = file_buffer;
+    *buf = input->buffer;
 
     return static_cast<unsigned>(read_bytes);
 }
 
+/*! A compressed stream already held in memory. */
+struct MemoryInput {
+    const unsigned char* data;
+    size_t size;
+};
+
+/**
+ * @brief Callback function for reading input from memory.
+ *
+ * Hands the remaining bytes to blast() in CHUNK-sized pieces.
+ *
+ * @param how Pointer to the MemoryInput.
+ * @param buf Pointer to the buffer where data will be stored.
+ * @return unsigned The number of bytes available.
+ */
+static unsigned in_from_memory(void* how, unsigned char** buf) {
+    MemoryInput* input = static_cast<MemoryInput *>(how);
+
+    const size_t len = input->size < CHUNK ? input->size : CHUNK;
+    *buf = const_cast<unsigned char *>(input->data);
+    input->data += len;
+    input->size -= len;
+
+    return static_cast<unsigned>(len);
+}
+
 /**
  * @brief Callback function for writing output to memory.
  *
@@ -215,6 +287,24 @@ static int out_to_memory(void* how, unsigned char* buf, const unsigned len) {
     return 0;
 }
 
+/**
+ * @brief Builds blast()'s static Huffman tables exactly once.
+ *
+ * blast() constructs its decoding tables lazily on the first call, which
+ * races when several files are decompressed at the same time. Decoding an
+ * empty stream (literal header, dictionary size 6, end code) under
+ * std::call_once builds them before any concurrent use.
+ */
+static void blast_init() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        static const unsigned char empty_stream[] = {0x00, 0x06, 0x01, 0xff};
+        MemoryInput input{empty_stream, sizeof(empty_stream)};
+        std::vector<unsigned char> output;
+        blast(in_from_memory, &input, out_to_memory, &output);
+    });
+}
+
 /**
  * @brief Decompresses the DBF file data.
  *
@@ -226,7 +316,10 @@ static int out_to_memory(void* how, unsigned char* buf, const unsigned len) {
 static int dbf_DecompressData(FILE* input, const uint16_t header_size,  std::vector<unsigned char>& output_buf) {
     if (fseek(input, header_size + 4, SEEK_SET) != 0) return -1;
 
-    int ret = blast(in_from_file, input, out_to_memory, &output_buf);
+    blast_init();
+
+    FileInput file_input{input, {}};
+    int ret = blast(in_from_file, &file_input, out_to_memory, &output_buf);
     if (ret != 0) {
         fprintf(stderr, "blast error: %d\n", ret);
         return -1;
@@ -236,6 +329,25 @@ static int dbf_DecompressData(FILE* input, const uint16_t header_size,  std::vec
 }
 
 
+/**
+ * @brief Parses the header and fields of a decompressed DBF buffer.
+ *
+ * @param dbf The DBF file structure, with mem_buffer filled.
+ * @param data_size The size announced by the header.
+ * @return bool true on success, false on failure.
+ */
+static bool dbf_ReadStructure(DBF& dbf, const uint64_t data_size) {
+    if (dbf_ReadHeaderInfo(dbf) != 0) return false;
+    if (dbf_ReadFieldInfo(dbf) != 0) return false;
+
+    if (dbf.mem_buffer.size() < data_size) {
+        fprintf(stderr, "truncated DBF data: %zu of %llu bytes\n", dbf.mem_buffer.size(), static_cast<unsigned long long>(data_size));
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * @brief Loads a DBF file into memory and processes its structure.
  *
@@ -253,13 +365,40 @@ bool dbc_load_dbf(FILE* input, DBF& dbf) {
         return false;
     }
 
+    const uint64_t data_size = dbf_ExpectedSize(dbf.mem_buffer);
+    if (data_size > header_size && data_size < SIZE_MAX) dbf.mem_buffer.reserve(static_cast<size_t>(data_size) + 1);
+
     if (dbf_DecompressData(input, header_size, dbf.mem_buffer) != 0) return false;
-    if (dbf_ReadHeaderInfo(dbf) != 0) return false;
-    if (dbf_ReadFieldInfo(dbf) != 0) return false;
 
-    return true;
+    return dbf_ReadStructure(dbf, data_size);
 }
 
+/**
+ * @brief Loads a DBF from the raw bytes of a DBC file already read into memory.
+ *
+ * @param data The whole DBC file.
+ * @param size Size of the DBC file in bytes.
+ * @param dbf The DBF file structure to populate.
+ * @return bool true on success, false on failure.
+ */
+bool dbc_load_dbf_from_memory(const unsigned char* data, const size_t size, DBF& dbf) {
+    if (size < 10) return false;
+    const uint16_t header_size = data[8] | (data[9] << 8);
+    if (size < static_cast<size_t>(header_size) + 4) return false;
+
+    dbf.mem_buffer.assign(data, data + header_size);
 
+    const uint64_t data_size = dbf_ExpectedSize(dbf.mem_buffer);
+    if (data_size > header_size && data_size < SIZE_MAX) dbf.mem_buffer.reserve(static_cast<size_t>(data_size) + 1);
 
+    blast_init();
+
+    MemoryInput input{data + header_size + 4, size - header_size - 4};
+    int ret = blast(in_from_memory, &input, out_to_memory, &dbf.mem_buffer);
+    if (ret != 0) {
+        fprintf(stderr, "blast error: %d\n", ret);
+        return false;
+    }
 
+    return dbf_ReadStructure(dbf, data_size);
+}
@@ -21,6 +21,8 @@
 #include <memory>
 #include  <vector>
 #include <cstdint>
+#include <cstdio>
+#include <string>
 
 #define CHUNK 4096
 #define _(str) (str)
@@ -98,7 +100,7 @@ struct DBF {
 	/*! number of fields */
 	uint32_t columns;
 	/*! record counter */
-	int cur_record;
+	int64_t cur_record;
     /*! enconding file */
 	std::string encoding;
 };
@@ -106,8 +108,10 @@ struct DBF {
 
 // I/O and memory utility functions
 bool dbc_load_dbf(FILE* input, DBF& dbf);
+bool dbc_load_dbf_from_memory(const unsigned char* data, size_t size, DBF& dbf);
+uint64_t dbc_estimated_size(FILE* input);
 unsigned int dbf_NumCols(const DBF& dbf);
 unsigned int dbf_NumRows(const DBF& dbf);
-std::string dbf_get_field_value(const DBF& dbf, int col, int row);
+std::string dbf_get_field_value(const DBF& dbf, int col, int64_t row);
 
 #endif //PROJECT_C_DBF_READER2_H
\ No newline at end of file
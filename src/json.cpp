@@ -0,0 +1,287 @@
+/*****************************************************************************
+ * @file json.cpp
+ * @brief Minimal JSON reader and writer helpers.
+ *
+ * A small recursive-descent parser for the documents the converter reads
+ * (schema override files and similar). It supports the full JSON grammar
+ * but keeps numbers as doubles. Documents the converter writes (shard
+ * manifests) are assembled by hand with json_quote() for the strings.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <cstdint>
+#include <string>
+#include "json.hpp"
+#include "libs/fast_float/fast_float.h"
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (kind != Kind::Object) return nullptr;
+    const auto it = object.find(key);
+    return it == object.end() ? nullptr : &it->second;
+}
+
+namespace {
+
+/**
+ * @brief Recursive-descent JSON parser over an in-memory document.
+ */
+class JsonParser {
+public:
+    explicit JsonParser(const std::string_view text) : text_(text) {}
+
+    arrow::Result<JsonValue> parse_document() {
+        JsonValue value;
+        ARROW_RETURN_NOT_OK(parse_value(value, 0));
+        skip_whitespace();
+        if (pos_ != text_.size()) return error("unexpected trailing characters");
+        return value;
+    }
+
+private:
+    static constexpr int max_depth = 64;
+
+    std::string_view text_;
+    size_t pos_ = 0;
+
+    arrow::Status error(const std::string& what) const {
+        return arrow::Status::Invalid("JSON parse error at offset ", pos_, ": ", what);
+    }
+
+    void skip_whitespace() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) pos_++;
+    }
+
+    bool consume(const std::string_view literal) {
+        if (text_.substr(pos_, literal.size()) != literal) return false;
+        pos_ += literal.size();
+        return true;
+    }
+
+    arrow::Status parse_value(JsonValue& out, const int depth) {
+        if (depth > max_depth) return error("nesting too deep");
+        skip_whitespace();
+        if (pos_ >= text_.size()) return error("unexpected end of input");
+
+        const char c = text_[pos_];
+        if (c == '{') return parse_object(out, depth);
+        if (c == '[') return parse_array(out, depth);
+        if (c == '"') {
+            out.kind = JsonValue::Kind::String;
+            return parse_string(out.string);
+        }
+        if (consume("true")) {
+            out.kind = JsonValue::Kind::Bool;
+            out.boolean = true;
+            return arrow::Status::OK();
+        }
+        if (consume("false")) {
+            out.kind = JsonValue::Kind::Bool;
+            out.boolean = false;
+            return arrow::Status::OK();
+        }
+        if (consume("null")) {
+            out.kind = JsonValue::Kind::Null;
+            return arrow::Status::OK();
+        }
+        return parse_number(out);
+    }
+
+    arrow::Status parse_object(JsonValue& out, const int depth) {
+        out.kind = JsonValue::Kind::Object;
+        pos_++;
+        skip_whitespace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            pos_++;
+            return arrow::Status::OK();
+        }
+
+        while (true) {
+            skip_whitespace();
+            if (pos_ >= text_.size() || text_[pos_] != '"') return error("expected object key");
+            std::string key;
+            ARROW_RETURN_NOT_OK(parse_string(key));
+
+            skip_whitespace();
+            if (pos_ >= text_.size() || text_[pos_] != ':') return error("expected ':'");
+            pos_++;
+
+            ARROW_RETURN_NOT_OK(parse_value(out.object[key], depth + 1));
+
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                pos_++;
+                continue;
+            }
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                pos_++;
+                return arrow::Status::OK();
+            }
+            return error("expected ',' or '}'");
+        }
+    }
+
+    arrow::Status parse_array(JsonValue& out, const int depth) {
+        out.kind = JsonValue::Kind::Array;
+        pos_++;
+        skip_whitespace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            pos_++;
+            return arrow::Status::OK();
+        }
+
+        while (true) {
+            out.array.emplace_back();
+            ARROW_RETURN_NOT_OK(parse_value(out.array.back(), depth + 1));
+
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                pos_++;
+                continue;
+            }
+            if (pos_ < text_.size() && text_[pos_] == ']') {
+                pos_++;
+                return arrow::Status::OK();
+            }
+            return error("expected ',' or ']'");
+        }
+    }
+
+    static void append_utf8(std::string& out, const uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    arrow::Status parse_hex4(uint32_t& out) {
+        if (pos_ + 4 > text_.size()) return error("truncated \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            const char h = text_[pos_++];
+            out <<= 4;
+            if (h >= '0' && h <= '9') out |= h - '0';
+            else if (h >= 'a' && h <= 'f') out |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') out |= h - 'A' + 10;
+            else return error("invalid \\u escape");
+        }
+        return arrow::Status::OK();
+    }
+
+    arrow::Status parse_string(std::string& out) {
+        pos_++;
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_++];
+            if (c == '"') return arrow::Status::OK();
+            if (static_cast<unsigned char>(c) < 0x20) return error("control character in string");
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (pos_ >= text_.size()) break;
+            switch (text_[pos_++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t cp;
+                    ARROW_RETURN_NOT_OK(parse_hex4(cp));
+                    if (cp >= 0xD800 && cp < 0xDC00 && consume("\\u")) {
+                        uint32_t low;
+                        ARROW_RETURN_NOT_OK(parse_hex4(low));
+                        if (low < 0xDC00 || low > 0xDFFF) return error("invalid surrogate pair");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default: return error("invalid escape");
+            }
+        }
+        return error("unterminated string");
+    }
+
+    arrow::Status parse_number(JsonValue& out) {
+        const char* begin = text_.data() + pos_;
+        const char* end = text_.data() + text_.size();
+        // fast_float rejects a leading '+', as JSON does, but also needs the '-' handled here.
+        const bool negative = begin < end && *begin == '-';
+
+        double value;
+        const auto result = fast_float::from_chars(begin + negative, end, value);
+        if (result.ec != std::errc() || begin + negative == result.ptr) return error("invalid value");
+
+        out.kind = JsonValue::Kind::Number;
+        out.number = negative ? -value : value;
+        pos_ = static_cast<size_t>(result.ptr - text_.data());
+        return arrow::Status::OK();
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Parses a complete JSON document.
+ *
+ * @param text The document text.
+ * @return JsonValue The root value, or an Invalid status with the error offset.
+ */
+arrow::Result<JsonValue> json_parse(const std::string_view text) {
+    return JsonParser(text).parse_document();
+}
+
+/**
+ * @brief Quotes and escapes a string as a JSON string literal.
+ *
+ * Bytes of 0x80 and above are copied unchanged, so UTF-8 text stays UTF-8.
+ *
+ * @param text The raw string.
+ * @return std::string The literal, including the surrounding quotes.
+ */
+std::string json_quote(const std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(text.size() + 2);
+    out += '"';
+    for (const char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xf];
+                    out += hex[c & 0xf];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+    return out;
+}
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * json.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Minimal JSON reader for schema files and other small documents.
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <arrow/result.h>
+
+/*! \struct JsonValue
+	\brief Parsed JSON document node
+*/
+struct JsonValue {
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    bool is_null() const { return kind == Kind::Null; }
+    bool is_bool() const { return kind == Kind::Bool; }
+    bool is_number() const { return kind == Kind::Number; }
+    bool is_string() const { return kind == Kind::String; }
+    bool is_array() const { return kind == Kind::Array; }
+    bool is_object() const { return kind == Kind::Object; }
+
+    /*! member lookup, nullptr if absent or not an object */
+    const JsonValue* find(const std::string& key) const;
+};
+
+/* json_parse()
+ * Parses a complete JSON document.
+ */
+arrow::Result<JsonValue> json_parse(std::string_view text);
+
+/* json_quote()
+ * Quotes and escapes a string as a JSON string literal.
+ */
+std::string json_quote(std::string_view text);
+
+#endif
@@ -23,15 +23,29 @@
 #include <unistd.h>
 #endif
 
+#include "batch_convert.hpp"
+#include "daemon.hpp"
+#include "dataset_summary.hpp"
 #include "dbf_reader.hpp"
+#include "memory_budget.hpp"
 #include "parquet_write.hpp"
+#include "schema_file.hpp"
+#include "sys_limits.hpp"
+#include "watch.hpp"
 #include <arrow/status.h>
+#include <arrow/util/thread_pool.h>
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
 /**
  * @brief Waits for user input only in interactive terminals.
@@ -46,23 +60,162 @@ void wait_if_interactive(bool no_wait) {
 }
 
 /**
- * @brief Generates an output filename for the Parquet file based on the input
- * filename.
+ * @brief Prints the detected limits, the thread pool size and the memory use.
+ */
+void print_resource_summary(const SystemLimits &limits,
+                            const ConvertOptions &options) {
+  const double mib = 1024.0 * 1024.0;
+  std::cout << "CPUs: " << limits.cpus << " (" << limits.cpu_source
+            << "), threads: " << arrow::GetCpuThreadPoolCapacity() << "\n";
+  if (limits.memory > 0)
+    std::cout << "Memory limit: " << limits.memory / mib << " MiB ("
+              << limits.memory_source << ")\n";
+  if (options.memory_budget)
+    std::cout << "Peak tracked memory: " << options.memory_budget->peak() / mib
+              << " MiB (budget " << options.memory_budget->limit() / mib
+              << " MiB)\n";
+}
+
+/**
+ * @brief Splits a comma-separated list of column names.
+ */
+std::vector<std::string> split_list(const std::string &text) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos)
+      end = text.size();
+    if (end > start)
+      items.push_back(text.substr(start, end - start));
+    start = end + 1;
+  }
+  return items;
+}
+
+/**
+ * @brief Parses the value of a size flag such as --page-size.
  *
- * This function takes the input filename, removes its extension (if any),
- * and appends ".parquet" to create the output filename.
+ * @param flag The flag, for the error message.
+ * @param text The value given, such as "1M".
+ * @param out Receives the size in bytes.
+ * @return bool false (after printing an error) if the value is not a positive size.
+ */
+bool parse_size_flag(const char *flag, const char *text, int64_t &out) {
+  out = parse_byte_size(text);
+  if (out > 0)
+    return true;
+  std::cerr << "Error: invalid " << flag << " size: " << text << "\n";
+  return false;
+}
+
+/**
+ * @brief Parses the value of a count flag such as --jobs.
  *
- * @param input_file The input filename (including path if applicable).
- * @return std::string The generated output filename for the Parquet file.
+ * @param flag The flag, for the error message.
+ * @param text The value given.
+ * @param out Receives the count.
+ * @return bool false (after printing an error) if the value is not a positive
+ * integer that fits `out`.
  */
-std::string generate_output_filename(const std::string &input_file) {
-  std::string output = input_file;
-  size_t pos = output.find_last_of('.');
-  if (pos != std::string::npos) {
-    output = output.substr(0, pos);
-  }
-  output += ".parquet";
-  return output;
+template <typename T>
+bool parse_count_flag(const char *flag, const char *text, T &out) {
+  char *end = nullptr;
+  errno = 0;
+  const long long value = std::strtoll(text, &end, 10);
+  if (errno == 0 && end != text && *end == '\0' && value > 0 &&
+      value <= std::numeric_limits<T>::max()) {
+    out = static_cast<T>(value);
+    return true;
+  }
+  std::cerr << "Error: " << flag << " must be a positive integer: " << text
+            << "\n";
+  return false;
+}
+
+/**
+ * @brief Writes the _metadata and _common_metadata of the files converted.
+ */
+arrow::Status write_summary(DatasetSummary &summary) {
+  ARROW_RETURN_NOT_OK(summary.write());
+  std::cout << "Summary metadata: "
+            << (std::filesystem::path(summary.root()) / "_metadata").string()
+            << "\n";
+  return arrow::Status::OK();
+}
+
+/**
+ * @brief Converts many files in one process and prints a summary.
+ *
+ * @param jobs The files to convert.
+ * @param options Conversion options, shared by all files.
+ * @param parallel_jobs Number of files converted at the same time.
+ * @param manifest Path of the JSON manifest to write, or empty for none.
+ * @param shard This node's shard, recorded in the manifest.
+ * @param shards Number of shards, recorded in the manifest.
+ * @return int 0 if every file was converted, -1 otherwise.
+ */
+int run_multi_file(std::vector<ConvertJob> jobs, const ConvertOptions &options,
+                   int parallel_jobs, const std::string &manifest, int shard,
+                   int shards) {
+  const size_t total = jobs.size();
+  size_t done = 0;
+
+  std::cout << "Files: " << total << " (" << parallel_jobs
+            << " at a time)\n\nStarting conversion...\n";
+
+  auto results = convert_files(
+      std::move(jobs), options, parallel_jobs,
+      [&](const ConvertResult &result) {
+        done++;
+        if (result.status.ok()) {
+          std::cout << "[" << done << "/" << total << "] " << result.job.input
+                    << " -> " << result.job.output << " (" << result.rows
+                    << " rows, " << result.seconds << " s)\n";
+        } else {
+          std::cout << "[" << done << "/" << total << "] " << result.job.input
+                    << " FAILED\n";
+        }
+      });
+
+  size_t failed = 0;
+  int64_t rows = 0;
+  for (const auto &result : results) {
+    if (result.status.ok())
+      rows += result.rows;
+    else
+      failed++;
+  }
+
+  std::cout << "\nConverted " << (total - failed) << " of " << total
+            << " files (" << rows << " rows)\n";
+  if (failed > 0) {
+    std::cerr << "\n" << failed << " file(s) failed:\n";
+    for (const auto &result : results) {
+      if (!result.status.ok())
+        std::cerr << "  " << result.job.input << ": "
+                  << result.status.ToString() << "\n";
+    }
+  }
+
+  if (!manifest.empty()) {
+    auto status = write_manifest(manifest, shard, shards, results);
+    if (!status.ok()) {
+      std::cerr << "Error: " << status.ToString() << "\n";
+      return -1;
+    }
+    std::cout << "Manifest: " << manifest << "\n";
+  }
+
+  if (options.dataset_summary) {
+    auto status = write_summary(*options.dataset_summary);
+    if (!status.ok()) {
+      std::cerr << "Error: " << status.ToString() << "\n";
+      return -1;
+    }
+  }
+
+  return failed == 0 ? 0 : -1;
 }
 
 /**
@@ -81,75 +234,441 @@ int main(const int argc, char **argv) {
   std::cout << "Author: Raicy Augusto | github.com/RaicyAugusto/dbc2parquet\n";
   std::cout << "==============================\n\n";
 
-  FILE *input = nullptr;
-  DBF dbf;
-
   bool no_wait = false;
+  bool summary_metadata = false;
+  ConvertOptions options;
+  const char *schema_file = nullptr;
+  int threads = 0;
+  int parallel_jobs = 0;
+  std::string output_dir;
+  std::string file_list;
+  const char *max_memory = nullptr;
+  const char *shard_spec = nullptr;
+  std::string manifest;
+  const char *daemon_socket = nullptr;
+  const char *watch_dir = nullptr;
+  const char *row_group_bytes = nullptr;
+  const char *page_size = nullptr;
+  const char *dictionary_page_limit = nullptr;
+  const char *compression = nullptr;
+  std::vector<std::string> column_compression;
+  const char *sorting_columns = nullptr;
+  const char *sort_by = nullptr;
+  const char *max_file_bytes = nullptr;
+  const char *cdc_chunk_size = nullptr;
+  const char *format = nullptr;
+  int shard = 0;
+  int shards = 1;
+
+  std::vector<std::string> positional;
   for (int i = 1; i < argc; i++) {
     if (std::strcmp(argv[i], "--no-wait") == 0)
       no_wait = true;
+    else if (std::strcmp(argv[i], "--infer-types") == 0)
+      options.infer_types = true;
+    else if (std::strcmp(argv[i], "--adaptive-encoding") == 0)
+      options.adaptive_encoding = true;
+    else if (std::strcmp(argv[i], "--summary-metadata") == 0)
+      summary_metadata = true;
+    else if (std::strcmp(argv[i], "--cdc") == 0)
+      options.content_defined_chunking = true;
+    else if (std::strcmp(argv[i], "--cdc-chunk-size") == 0 && i + 1 < argc)
+      cdc_chunk_size = argv[++i];
+    else if (std::strcmp(argv[i], "--cdc-norm-level") == 0 && i + 1 < argc) {
+      options.cdc_norm_level = std::atoi(argv[++i]);
+      options.content_defined_chunking = true;
+    } else if (std::strcmp(argv[i], "--schema-file") == 0 && i + 1 < argc)
+      schema_file = argv[++i];
+    else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+      options.workers = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+      if (!parse_count_flag("--queue-depth", argv[++i], options.queue_depth))
+        return -1;
+    } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      if (!parse_count_flag("--jobs", argv[++i], parallel_jobs))
+        return -1;
+    } else if (std::strcmp(argv[i], "--output-dir") == 0 && i + 1 < argc)
+      output_dir = argv[++i];
+    else if (std::strcmp(argv[i], "--file-list") == 0 && i + 1 < argc)
+      file_list = argv[++i];
+    else if (std::strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc)
+      max_memory = argv[++i];
+    else if (std::strcmp(argv[i], "--shard") == 0 && i + 1 < argc)
+      shard_spec = argv[++i];
+    else if (std::strcmp(argv[i], "--manifest") == 0 && i + 1 < argc)
+      manifest = argv[++i];
+    else if (std::strcmp(argv[i], "--daemon") == 0 && i + 1 < argc)
+      daemon_socket = argv[++i];
+    else if (std::strcmp(argv[i], "--watch") == 0 && i + 1 < argc)
+      watch_dir = argv[++i];
+    else if (std::strcmp(argv[i], "--row-group-rows") == 0 && i + 1 < argc) {
+      if (!parse_count_flag("--row-group-rows", argv[++i],
+                            options.row_group_rows))
+        return -1;
+    } else if (std::strcmp(argv[i], "--row-group-bytes") == 0 && i + 1 < argc)
+      row_group_bytes = argv[++i];
+    else if (std::strcmp(argv[i], "--page-size") == 0 && i + 1 < argc)
+      page_size = argv[++i];
+    else if (std::strcmp(argv[i], "--dictionary-page-limit") == 0 &&
+             i + 1 < argc)
+      dictionary_page_limit = argv[++i];
+    else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+      format = argv[++i];
+    else if (std::strcmp(argv[i], "--compression") == 0 && i + 1 < argc)
+      compression = argv[++i];
+    else if (std::strcmp(argv[i], "--column-compression") == 0 &&
+             i + 1 < argc)
+      column_compression.push_back(argv[++i]);
+    else if (std::strcmp(argv[i], "--bloom-filter") == 0 && i + 1 < argc) {
+      for (auto &column : split_list(argv[++i]))
+        options.bloom_filter_columns.push_back(column);
+    } else if (std::strcmp(argv[i], "--bloom-fpp") == 0 && i + 1 < argc)
+      options.bloom_filter_fpp = std::atof(argv[++i]);
+    else if (std::strcmp(argv[i], "--bloom-ndv") == 0 && i + 1 < argc)
+      options.bloom_filter_ndv = std::atoll(argv[++i]);
+    else if (std::strcmp(argv[i], "--page-index") == 0 && i + 1 < argc) {
+      for (auto &column : split_list(argv[++i]))
+        options.page_index_columns.push_back(column == "all" ? "*" : column);
+    } else if (std::strcmp(argv[i], "--sorting-columns") == 0 && i + 1 < argc)
+      sorting_columns = argv[++i];
+    else if (std::strcmp(argv[i], "--sort-by") == 0 && i + 1 < argc)
+      sort_by = argv[++i];
+    else if (std::strcmp(argv[i], "--partition-by") == 0 && i + 1 < argc)
+      options.partition_by = split_list(argv[++i]);
+    else if (std::strcmp(argv[i], "--partition-writers") == 0 &&
+             i + 1 < argc) {
+      if (!parse_count_flag("--partition-writers", argv[++i],
+                            options.partition_writers))
+        return -1;
+    } else if (std::strcmp(argv[i], "--max-file-bytes") == 0 && i + 1 < argc)
+      max_file_bytes = argv[++i];
+    else if (std::strcmp(argv[i], "--max-file-rows") == 0 && i + 1 < argc) {
+      if (!parse_count_flag("--max-file-rows", argv[++i],
+                            options.max_file_rows))
+        return -1;
+    } else
+      positional.push_back(argv[i]);
   }
 
-  int argc_real = 0;
-  const char *argv_real[3] = {nullptr, nullptr, nullptr};
-  for (int i = 0; i < argc && argc_real < 3; i++) {
-    if (std::strcmp(argv[i], "--no-wait") != 0) {
-      argv_real[argc_real++] = argv[i];
+  if (format) {
+    auto status = parse_output_format(format, options);
+    if (!status.ok()) {
+      std::cerr << "Error: --format: " << status.ToString() << "\n";
+      return -1;
     }
   }
 
-  auto start = std::chrono::high_resolution_clock::now();
+  // One input (and optionally one .parquet or .arrow output) keeps the
+  // single-file behaviour; directories, patterns, lists or several inputs
+  // convert many.
+  bool multi_file =
+      !output_dir.empty() || !file_list.empty() || shard_spec ||
+      positional.size() > 2 ||
+      (positional.size() == 2 &&
+       positional[1].find(options.output_extension()) == std::string::npos);
+  for (const auto &path : positional) {
+    std::error_code ec;
+    if (path.find_first_of("*?") != std::string::npos ||
+        std::filesystem::is_directory(path, ec))
+      multi_file = true;
+  }
+
+  // The daemon and the watcher take their files as they come
+  const bool service = daemon_socket || watch_dir;
 
-  const char *input_file;
-  const char *output_file;
+  if (positional.empty() && file_list.empty() && !service) {
+    std::cerr << "Usage: " << argv[0] << " input.dbc [output.parquet]\n";
+    std::cerr << "       " << argv[0]
+              << " [--output-dir DIR] [--jobs N] [--file-list FILE] "
+                 "FILE|DIR|PATTERN...\n";
+    std::cerr << "       " << argv[0] << " --daemon SOCKET\n";
+    std::cerr << "       " << argv[0] << " --watch DIR [--output-dir DIR]\n";
+    return -1;
+  }
 
-  if (argc_real == 2) {
-    input_file = argv_real[1];
-    static std::string output_name = generate_output_filename(input_file);
-    output_file = output_name.c_str();
-    std::cout << "Input: " << input_file << std::endl;
-    std::cout << "Output: " << output_file << std::endl;
-  } else if (argc_real == 3) {
-    input_file = argv_real[1];
-    output_file = argv_real[2];
+  if (shard_spec &&
+      (std::sscanf(shard_spec, "%d/%d", &shard, &shards) != 2 || shards < 1 ||
+       shard < 0 || shard >= shards)) {
+    std::cerr << "Error: --shard expects i/N with 0 <= i < N, got "
+              << shard_spec << "\n";
+    return -1;
+  }
 
-    if (std::strstr(argv_real[1], ".dbc") == nullptr ||
-        std::strstr(argv_real[2], ".parquet") == nullptr) {
-      std::cerr << "Usage: " << argv[0] << " input.dbc output.parquet\n";
+  if (row_group_bytes) {
+    if (std::strcmp(row_group_bytes, "auto") == 0)
+      options.row_group_bytes = ConvertOptions::kAutoRowGroupBytes;
+    else if (!parse_size_flag("--row-group-bytes", row_group_bytes,
+                              options.row_group_bytes))
+      return -1;
+  }
+  if ((page_size &&
+       !parse_size_flag("--page-size", page_size, options.page_size)) ||
+      (dictionary_page_limit &&
+       !parse_size_flag("--dictionary-page-limit", dictionary_page_limit,
+                        options.dictionary_page_limit)))
+    return -1;
+  // "archive" trades write time for the smallest files
+  if (compression && std::strcmp(compression, "archive") == 0) {
+    options.compression.level = 19;
+    options.adaptive_encoding = true;
+  } else if (compression) {
+    auto spec = parse_compression(compression);
+    if (!spec.ok()) {
+      std::cerr << "Error: --compression: " << spec.status().ToString()
+                << "\n";
       return -1;
     }
-  } else {
-    std::cerr << "Usage: " << argv[0] << " input.dbc [output.parquet]\n";
+    options.compression = *spec;
+    if (options.compression.codec.empty())
+      options.compression.codec = "zstd";
+  }
+  for (const auto &column : column_compression) {
+    const size_t equals = column.find('=');
+    auto spec = equals == std::string::npos || equals == 0
+                    ? arrow::Result<CompressionSpec>(arrow::Status::Invalid(
+                          "expected NAME=CODEC[:LEVEL] or NAME=LEVEL"))
+                    : parse_compression(column.substr(equals + 1));
+    if (!spec.ok()) {
+      std::cerr << "Error: --column-compression " << column << ": "
+                << spec.status().ToString() << "\n";
+      return -1;
+    }
+    options.column_compression[column.substr(0, equals)] = *spec;
+  }
+  if (cdc_chunk_size) {
+    // MIN:MAX, or a single maximum with a quarter of it as the minimum, as
+    // in the writer's defaults
+    const std::string sizes = cdc_chunk_size;
+    const size_t colon = sizes.find(':');
+    const std::string min_size =
+        colon == std::string::npos ? "" : sizes.substr(0, colon);
+    const std::string max_size =
+        colon == std::string::npos ? sizes : sizes.substr(colon + 1);
+    if ((!min_size.empty() &&
+         !parse_size_flag("--cdc-chunk-size", min_size.c_str(),
+                          options.cdc_min_chunk_size)) ||
+        !parse_size_flag("--cdc-chunk-size", max_size.c_str(),
+                         options.cdc_max_chunk_size))
+      return -1;
+    if (min_size.empty())
+      options.cdc_min_chunk_size =
+          std::max<int64_t>(options.cdc_max_chunk_size / 4, 1);
+    options.content_defined_chunking = true;
+  }
+  if (options.cdc_norm_level < -8 || options.cdc_norm_level > 8) {
+    std::cerr << "Error: --cdc-norm-level must be between -8 and 8\n";
+    return -1;
+  }
+  if (options.bloom_filter_fpp <= 0 || options.bloom_filter_fpp >= 1) {
+    std::cerr << "Error: --bloom-fpp must be between 0 and 1\n";
+    return -1;
+  }
+  if (sorting_columns) {
+    auto keys = parse_sort_keys(sorting_columns);
+    if (!keys.ok()) {
+      std::cerr << "Error: --sorting-columns: " << keys.status().ToString()
+                << "\n";
+      return -1;
+    }
+    options.sorting_columns = *keys;
+  }
+  if (sort_by) {
+    auto keys = parse_sort_keys(sort_by);
+    if (!keys.ok()) {
+      std::cerr << "Error: --sort-by: " << keys.status().ToString() << "\n";
+      return -1;
+    }
+    options.sort_by = *keys;
+  }
+  if (max_file_bytes &&
+      !parse_size_flag("--max-file-bytes", max_file_bytes,
+                       options.max_file_bytes))
+    return -1;
+  if (options.max_file_rows < 0) {
+    std::cerr << "Error: --max-file-rows must be positive\n";
+    return -1;
+  }
+  if (options.partition_writers < 1) {
+    std::cerr << "Error: --partition-writers must be positive\n";
+    return -1;
+  }
+  if (options.row_group_rows < 0) {
+    std::cerr << "Error: --row-group-rows must be positive\n";
     return -1;
   }
 
-  std::cout << "\nStarting conversion...\n";
+  auto start = std::chrono::high_resolution_clock::now();
 
-  input = fopen(input_file, "rb");
-  if (!input) {
-    std::cerr << "Error opening input file: " << input_file << "\n";
-    wait_if_interactive(no_wait);
-    return -1;
+  std::string input_file;
+  std::string output_file;
+
+  if (!multi_file && !service) {
+    input_file = positional[0];
+    if (positional.size() == 2) {
+      output_file = positional[1];
+
+      if (input_file.find(".dbc") == std::string::npos) {
+        std::cerr << "Usage: " << argv[0] << " input.dbc output.parquet\n";
+        return -1;
+      }
+    } else {
+      output_file =
+          generate_output_filename(input_file, options.output_extension());
+      std::cout << "Input: " << input_file << std::endl;
+      std::cout << "Output: " << output_file << std::endl;
+    }
   }
 
-  // Decompress DBC data
-  if (!dbc_load_dbf(input, dbf)) {
-    std::cerr << "Error loading DBC data\n";
-    std::fclose(input);
+  // The summary covers one directory of files written by this process
+  if (summary_metadata) {
+    const char *problem = nullptr;
+    if (service)
+      problem = "does not apply to --daemon or --watch";
+    else if (options.format != OutputFormat::kParquet)
+      problem = "only applies to Parquet output";
+    else if (shard_spec)
+      problem = "cannot be combined with --shard, whose nodes would "
+                "overwrite each other's summary";
+    else if (multi_file && output_dir.empty())
+      problem = "needs --output-dir in multi-file runs";
+    else if (!multi_file && options.single_file())
+      problem = "needs several files: a multi-file, partitioned or split run";
+    if (problem) {
+      std::cerr << "Error: --summary-metadata " << problem << "\n";
+      return -1;
+    }
+    options.dataset_summary = std::make_shared<DatasetSummary>(
+        multi_file ? output_dir
+                   : std::filesystem::path(output_file).parent_path().string());
+  }
+
+  // Default to the CPUs and memory of the container, not of the host. The
+  // budget only delays work (admission and queue backpressure); it never
+  // changes where row groups end, so the output is the same on any machine.
+  const SystemLimits limits = detect_system_limits();
+  if (threads <= 0)
+    threads = limits.cpus;
+
+  if (threads != arrow::GetCpuThreadPoolCapacity()) {
+    auto status = arrow::SetCpuThreadPoolCapacity(threads);
+    if (!status.ok()) {
+      std::cerr << "Error: " << status.ToString() << "\n";
+      wait_if_interactive(no_wait);
+      return -1;
+    }
+  }
+
+  if (max_memory) {
+    const int64_t limit = parse_byte_size(max_memory);
+    if (limit <= 0) {
+      std::cerr << "Error: invalid --max-memory size: " << max_memory << "\n";
+      wait_if_interactive(no_wait);
+      return -1;
+    }
+    options.memory_budget = std::make_shared<MemoryBudget>(limit);
+  } else if (limits.memory > 0) {
+    options.memory_budget =
+        std::make_shared<MemoryBudget>(limits.memory / 4 * 3);
+  }
+
+  if (schema_file) {
+    auto overrides = load_schema_file(schema_file);
+    if (!overrides.ok()) {
+      std::cerr << "Error: " << overrides.status().ToString() << "\n";
+      wait_if_interactive(no_wait);
+      return -1;
+    }
+    options.schema_overrides = *overrides;
+  }
+
+  // Long-running modes keep decompression buffers between files, up to 256 MiB
+  if (service)
+    options.buffer_pool = std::make_shared<BufferPool>(size_t{256} << 20);
+
+  if (daemon_socket) {
+    if (parallel_jobs <= 0)
+      parallel_jobs = arrow::GetCpuThreadPoolCapacity();
+    auto status = run_daemon(daemon_socket, options, parallel_jobs);
+    if (!status.ok()) {
+      std::cerr << "Error: " << status.ToString() << "\n";
+      return -1;
+    }
+    print_resource_summary(limits, options);
+    return 0;
+  }
+
+  if (watch_dir) {
+    if (parallel_jobs <= 0)
+      parallel_jobs = arrow::GetCpuThreadPoolCapacity();
+    auto status = run_watch(watch_dir, output_dir, options, parallel_jobs);
+    if (!status.ok()) {
+      std::cerr << "Error: " << status.ToString() << "\n";
+      return -1;
+    }
+    print_resource_summary(limits, options);
+    return 0;
+  }
+
+  if (multi_file) {
+    auto jobs = collect_jobs(positional, file_list, output_dir,
+                             options.output_extension());
+    if (!jobs.ok()) {
+      std::cerr << "Error: " << jobs.status().ToString() << "\n";
+      wait_if_interactive(no_wait);
+      return -1;
+    }
+    if (shard_spec) {
+      const size_t total = jobs->size();
+      *jobs = select_shard(std::move(*jobs), shard, shards);
+      std::cout << "Shard " << shard << "/" << shards << ": " << jobs->size()
+                << " of " << total << " files\n";
+      if (manifest.empty())
+        manifest = (std::filesystem::path(output_dir) /
+                    ("manifest-" + std::to_string(shard) + "-of-" +
+                     std::to_string(shards) + ".json"))
+                       .string();
+    } else if (jobs->empty()) {
+      std::cerr << "No DBC files found\n";
+      wait_if_interactive(no_wait);
+      return -1;
+    }
+
+    if (parallel_jobs <= 0)
+      parallel_jobs = arrow::GetCpuThreadPoolCapacity();
+
+    int result = run_multi_file(std::move(*jobs), options, parallel_jobs,
+                                manifest, shard, shards);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration_sec =
+        std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+    std::cout << "Time elapsed: " << duration_sec.count() << " seconds\n";
+    print_resource_summary(limits, options);
+
     wait_if_interactive(no_wait);
-    return -1;
+    return result;
   }
 
-  std::fclose(input);
+  std::cout << "\nStarting conversion...\n";
 
-  // Write Parquet file
-  auto status = write_parquet(dbf, output_file);
+  auto status = convert_file(input_file, output_file, options);
   if (!status.ok()) {
     std::cerr << "Error: " << status.ToString() << "\n";
     wait_if_interactive(no_wait);
     return -1;
   }
 
+  if (options.dataset_summary) {
+    status = write_summary(*options.dataset_summary);
+    if (!status.ok()) {
+      std::cerr << "Error: " << status.ToString() << "\n";
+      wait_if_interactive(no_wait);
+      return -1;
+    }
+  }
+
   auto end = std::chrono::high_resolution_clock::now();
   auto duration_sec =
       std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
@@ -157,6 +676,7 @@ int main(const int argc, char **argv) {
   std::cout << "\n Conversion completed successfully!\n";
   std::cout << "Time elapsed: " << duration_sec.count() << " seconds\n";
   std::cout << "Output saved to: " << output_file << "\n";
+  print_resource_summary(limits, options);
 
   wait_if_interactive(no_wait);
 
@@ -0,0 +1,157 @@
+/*****************************************************************************
+ * @file memory_budget.cpp
+ * @brief Memory accounting for --max-memory.
+ *
+ * The footprint of a conversion is the decompressed DBF buffer, the batches
+ * being built and the row group buffered by the Parquet writer. The first is
+ * charged up front with a MemoryReservation sized from the DBC header; the
+ * other two are allocated through a BudgetedMemoryPool. When the total goes
+ * over the limit, batch producers stall and multi-file runs wait before
+ * loading the next file. Row groups still end where their length says, so
+ * the budget never changes the output.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include "memory_budget.hpp"
+
+/**
+ * @brief Charges bytes to the budget and updates the peak.
+ *
+ * @param bytes Number of bytes now held.
+ */
+void MemoryBudget::add(const int64_t bytes) {
+    const int64_t now = used_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = peak_.load(std::memory_order_relaxed);
+    while (now > peak && !peak_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Reserves bytes for a large buffer, waiting until they fit.
+ *
+ * A reservation is always granted when no other one is held, so a single
+ * file larger than the whole budget still converts, just alone. Arrow
+ * allocations are freed without notification, so the wait re-checks the
+ * usage periodically.
+ *
+ * @param bytes Number of bytes to reserve.
+ */
+void MemoryBudget::acquire(const int64_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (limit_ > 0 && reservations_ > 0 && used() + bytes > limit_) {
+        released_.wait_for(lock, std::chrono::milliseconds(20));
+    }
+    reservations_++;
+    add(bytes);
+}
+
+/**
+ * @brief Returns a reservation made by acquire().
+ *
+ * @param bytes Number of bytes reserved.
+ */
+void MemoryBudget::release(const int64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reservations_--;
+        remove(bytes);
+    }
+    released_.notify_all();
+}
+
+arrow::Status BudgetedMemoryPool::Allocate(const int64_t size, const int64_t alignment, uint8_t** out) {
+    ARROW_RETURN_NOT_OK(base_->Allocate(size, alignment, out));
+    bytes_allocated_.fetch_add(size, std::memory_order_relaxed);
+    total_bytes_allocated_.fetch_add(size, std::memory_order_relaxed);
+    num_allocations_.fetch_add(1, std::memory_order_relaxed);
+    budget_->add(size);
+    return arrow::Status::OK();
+}
+
+arrow::Status BudgetedMemoryPool::Reallocate(const int64_t old_size, const int64_t new_size, const int64_t alignment,
+                                             uint8_t** ptr) {
+    ARROW_RETURN_NOT_OK(base_->Reallocate(old_size, new_size, alignment, ptr));
+    bytes_allocated_.fetch_add(new_size - old_size, std::memory_order_relaxed);
+    if (new_size > old_size) total_bytes_allocated_.fetch_add(new_size - old_size, std::memory_order_relaxed);
+    num_allocations_.fetch_add(1, std::memory_order_relaxed);
+    if (new_size > old_size) budget_->add(new_size - old_size);
+    else budget_->remove(old_size - new_size);
+    return arrow::Status::OK();
+}
+
+void BudgetedMemoryPool::Free(uint8_t* buffer, const int64_t size, const int64_t alignment) {
+    base_->Free(buffer, size, alignment);
+    bytes_allocated_.fetch_sub(size, std::memory_order_relaxed);
+    budget_->remove(size);
+}
+
+/**
+ * @brief Takes the smallest idle buffer that holds at least `capacity` bytes.
+ *
+ * @param capacity Bytes the caller will store.
+ * @return std::vector<unsigned char> An empty buffer, with that capacity if one was idle.
+ */
+std::vector<unsigned char> BufferPool::acquire(const size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto best = buffers_.end();
+    for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+        if (it->capacity() >= capacity && (best == buffers_.end() || it->capacity() < best->capacity())) best = it;
+    }
+    if (best == buffers_.end()) return {};
+
+    std::vector<unsigned char> buffer = std::move(*best);
+    buffers_.erase(best);
+    retained_ -= buffer.capacity();
+    buffer.clear();
+    return buffer;
+}
+
+/**
+ * @brief Keeps a buffer for reuse, unless that would exceed the retention limit.
+ */
+void BufferPool::release(std::vector<unsigned char> buffer) {
+    if (buffer.capacity() == 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retained_ + buffer.capacity() > max_retained_) return;
+    retained_ += buffer.capacity();
+    buffers_.push_back(std::move(buffer));
+}
+
+/**
+ * @brief Parses a byte count with an optional binary suffix.
+ *
+ * Accepts K, M, G and T (powers of 1024), optionally followed by "B" or
+ * "iB", in any case: "512M", "4GiB", "1048576".
+ *
+ * @param text The size as typed on the command line.
+ * @return int64_t The number of bytes, or -1 if the text is not a size.
+ */
+int64_t parse_byte_size(const std::string& text) {
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0) return -1;
+
+    std::string suffix(end);
+    for (auto& c : suffix) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    if (suffix.size() > 1 && suffix.back() == 'B') suffix.pop_back();
+    if (suffix.size() > 1 && suffix.back() == 'I') suffix.pop_back();
+
+    double scale;
+    if (suffix.empty() || suffix == "B") scale = 1;
+    else if (suffix == "K") scale = 1024.0;
+    else if (suffix == "M") scale = 1024.0 * 1024;
+    else if (suffix == "G") scale = 1024.0 * 1024 * 1024;
+    else if (suffix == "T") scale = 1024.0 * 1024 * 1024 * 1024;
+    else return -1;
+
+    return static_cast<int64_t>(value * scale);
+}
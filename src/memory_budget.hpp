@@ -0,0 +1,127 @@
+/*****************************************************************************
+ * memory_budget.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for memory_budget.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <arrow/memory_pool.h>
+
+/*! \class MemoryBudget
+	\brief Process-wide accounting of the memory held by conversions
+
+	Counts the bytes held by Arrow allocations (through BudgetedMemoryPool) and
+	by decompressed DBF buffers (through MemoryReservation) against a limit.
+	The budget never fails an allocation; callers check exceeded() and back off.
+*/
+class MemoryBudget {
+public:
+    /*! limit in bytes; 0 only tracks usage */
+    explicit MemoryBudget(int64_t limit) : limit_(limit) {}
+
+    int64_t limit() const { return limit_; }
+    int64_t used() const { return used_.load(std::memory_order_relaxed); }
+    int64_t peak() const { return peak_.load(std::memory_order_relaxed); }
+    bool exceeded() const { return limit_ > 0 && used() > limit_; }
+
+    void add(int64_t bytes);
+    void remove(int64_t bytes) { used_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+    void acquire(int64_t bytes);
+    void release(int64_t bytes);
+
+private:
+    const int64_t limit_;
+    std::atomic<int64_t> used_{0};
+    std::atomic<int64_t> peak_{0};
+    std::mutex mutex_;
+    std::condition_variable released_;
+    int reservations_ = 0;
+};
+
+/*! \class MemoryReservation
+	\brief Holds part of a MemoryBudget for the lifetime of a large buffer
+*/
+class MemoryReservation {
+public:
+    MemoryReservation(MemoryBudget* budget, int64_t bytes) : budget_(budget), bytes_(bytes) {
+        if (budget_) budget_->acquire(bytes_);
+    }
+    ~MemoryReservation() {
+        if (budget_) budget_->release(bytes_);
+    }
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+private:
+    MemoryBudget* budget_;
+    int64_t bytes_;
+};
+
+/*! \class BudgetedMemoryPool
+	\brief Arrow memory pool that charges every allocation to a MemoryBudget
+*/
+class BudgetedMemoryPool : public arrow::MemoryPool {
+public:
+    BudgetedMemoryPool(arrow::MemoryPool* base, MemoryBudget* budget) : base_(base), budget_(budget) {}
+
+    arrow::Status Allocate(int64_t size, int64_t alignment, uint8_t** out) override;
+    arrow::Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment, uint8_t** ptr) override;
+    void Free(uint8_t* buffer, int64_t size, int64_t alignment) override;
+    void ReleaseUnused() override { base_->ReleaseUnused(); }
+
+    int64_t bytes_allocated() const override { return bytes_allocated_.load(std::memory_order_relaxed); }
+    int64_t total_bytes_allocated() const override { return total_bytes_allocated_.load(std::memory_order_relaxed); }
+    int64_t num_allocations() const override { return num_allocations_.load(std::memory_order_relaxed); }
+    std::string backend_name() const override { return base_->backend_name(); }
+
+private:
+    arrow::MemoryPool* base_;
+    MemoryBudget* budget_;
+    std::atomic<int64_t> bytes_allocated_{0};
+    std::atomic<int64_t> total_bytes_allocated_{0};
+    std::atomic<int64_t> num_allocations_{0};
+};
+
+/*! \class BufferPool
+	\brief Keeps the decompression buffers of finished files for later ones
+
+	A long-running process converts file after file; reusing the multi-MB DBF
+	buffers avoids faulting in fresh pages for every file. At most
+	max_retained bytes are kept.
+*/
+class BufferPool {
+public:
+    explicit BufferPool(size_t max_retained) : max_retained_(max_retained) {}
+
+    std::vector<unsigned char> acquire(size_t capacity);
+    void release(std::vector<unsigned char> buffer);
+
+private:
+    const size_t max_retained_;
+    size_t retained_ = 0;
+    std::mutex mutex_;
+    std::vector<std::vector<unsigned char>> buffers_;
+};
+
+/* parse_byte_size()
+ * Parses sizes like "512M", "4G" or "1048576"; returns -1 if invalid.
+ */
+int64_t parse_byte_size(const std::string& text);
+
+#endif
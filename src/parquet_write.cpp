@@ -10,8 +10,9 @@
  * - Creation of Arrow schemas based on DBF field definitions
  * - Efficient batch processing of DBF records
  * - Conversion of various DBF data types to Arrow-compatible formats
+ * - Native decoding of binary FoxPro/dBASE 7 fields (I, +, B, O, Y, T, @)
  * - UTF-8 encoding conversion for text fields
- * - Optimized Parquet file writing with ZSTD compression
+ * - Optimized Parquet file writing with ZSTD (or configurable) compression
  *
  * @author Raicy Augusto
  * @version 1.0
@@ -28,14 +29,40 @@
  * large DBF files with optimal performance.
  ****************************************************************************/
 
-#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <arrow/api.h>
 #include "dbf_reader.hpp"
 #include <arrow/io/file.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/util/base64.h>
+#include <arrow/util/compression.h>
+#include <arrow/util/key_value_metadata.h>
 #include <arrow/util/macros.h>
+#include <arrow/util/parallel.h>
+#include <arrow/util/thread_pool.h>
 #include "parquet_write.hpp"
 #include <parquet/arrow/writer.h>
 #include "libs/fast_float/fast_float.h"
@@ -45,40 +72,385 @@
 #include <windows.h>
 #else
 #include <iconv.h>
-#include <charconv>
 #endif
 
 
+/**
+ * @brief Checks if a field is stored as raw binary instead of ASCII text.
+ *
+ * Visual FoxPro and dBASE 7 store integers (I, +), doubles (B, O), currency (Y)
+ * and datetimes (T, @) as fixed-size binary values. dBASE III/IV use 'B' for a
+ * 10-byte memo block number, so 'B' is only binary when it is 8 bytes long.
+ *
+ * @param field The field descriptor.
+ * @return true If the field holds binary data.
+ */
+static bool is_binary_field(const DB_FIELD& field) {
+    switch (field.field_type) {
+        case 'I': case '+': return field.field_length == 4;
+        case 'B': case 'O': case 'Y': case 'T': case '@': return field.field_length == 8;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Checks if binary fields are in dBASE 7 layout (big-endian, sign bit flipped).
+ *
+ * @param dbf The DBF file structure.
+ * @return true For dBASE 7 tables (version 0x04 or 0x8C), false for FoxPro.
+ */
+static bool is_dbase7(const DBF& dbf) {
+    return (dbf.header->version & 0x07) == 0x04;
+}
+
+/*! Digit order of a date stored as 8 characters of text. */
+enum class DateOrder { YMD, DMY };
+
+/**
+ * @brief Decoding plan of one column: its Arrow type and how its bytes are parsed.
+ */
+struct ColumnSpec {
+    /*! Arrow type written to the output */
+    std::shared_ptr<arrow::DataType> type;
+    /*! digit order for DATE32 columns decoded from text */
+    DateOrder date_order = DateOrder::YMD;
+    /*! trimmed values exported as null */
+    std::vector<std::string> null_values;
+    /*! type fixed by a schema file, skipped by inference */
+    bool pinned = false;
+};
+
+/**
+ * @brief Maps a DBF field descriptor to its default Arrow type.
+ *
+ * @param field The field descriptor.
+ * @return std::shared_ptr<arrow::DataType> The Arrow type of the field.
+ */
+static std::shared_ptr<arrow::DataType> field_arrow_type(const DB_FIELD& field) {
+    if (is_binary_field(field)) {
+        switch (field.field_type) {
+            case 'I': case '+': return arrow::int32();
+            case 'B': case 'O': return arrow::float64();
+            case 'Y': return arrow::decimal128(19, 4);
+            default: return arrow::timestamp(arrow::TimeUnit::MILLI);
+        }
+    }
+
+    switch (field.field_type) {
+        case 'C': return arrow::utf8();
+        case 'N':
+            if (field.field_decimals > 0) return arrow::float64();
+            return (field.field_length <= 9) ? arrow::int32() : arrow::int64();
+        case 'F': return arrow::float64();
+        case 'D': return arrow::date32();
+        case 'L': return arrow::boolean();
+        default: return arrow::utf8();
+    }
+}
+
+/**
+ * @brief Returns the field without leading and trailing whitespace, without modifying it.
+ *
+ * @param data Pointer to the field bytes.
+ * @param len Length of the field.
+ * @return std::string_view The trimmed field.
+ */
+static inline std::string_view trim_view(const char* data, size_t len) {
+    while (len > 0 && isspace(static_cast<unsigned char>(*data))) {
+        data++;
+        len--;
+    }
+    while (len > 0 && isspace(static_cast<unsigned char>(data[len - 1]))) len--;
+
+    return {data, len};
+}
+
+/**
+ * @brief Converts a civil date to days since 1970-01-01 (proleptic Gregorian).
+ *
+ * Days past the end of the month roll over into the next one, like mktime().
+ */
+static inline int32_t days_from_civil(int year, const unsigned month, const unsigned day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+/**
+ * @brief Formats days since 1970-01-01 as YYYY-MM-DD, the inverse of days_from_civil().
+ */
+static std::string civil_from_days(const int32_t days) {
+    const int z = days + 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    const int year = static_cast<int>(yoe) + era * 400 + (month <= 2);
+
+    char text[32];
+    std::snprintf(text, sizeof(text), "%04d-%02u-%02u", year, month, day);
+    return text;
+}
+
+/**
+ * @brief Parses an 8-digit date (YYYYMMDD or DDMMYYYY).
+ *
+ * @param str Pointer to the trimmed text.
+ * @param len Length of the text.
+ * @param order Digit order of the date.
+ * @param strict Reject days past the end of the month instead of rolling over.
+ * @param days Receives the days since the Unix epoch.
+ * @return true If the text is a date.
+ */
+static bool parse_date(const char* str, const size_t len, const DateOrder order, const bool strict, int32_t& days) {
+    if (len != 8) return false;
+
+    int digits[8];
+    for (int i = 0; i < 8; i++) {
+        if (str[i] < '0' || str[i] > '9') return false;
+        digits[i] = str[i] - '0';
+    }
+
+    const int y0 = (order == DateOrder::YMD) ? 0 : 4;
+    const int m0 = (order == DateOrder::YMD) ? 4 : 2;
+    const int d0 = (order == DateOrder::YMD) ? 6 : 0;
+    const int year = digits[y0] * 1000 + digits[y0 + 1] * 100 + digits[y0 + 2] * 10 + digits[y0 + 3];
+    const int month = digits[m0] * 10 + digits[m0 + 1];
+    const int day = digits[d0] * 10 + digits[d0 + 1];
+
+    if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+    if (strict) {
+        static const int month_days[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        if (day > month_days[month - 1] || (month == 2 && day == 29 && !leap)) return false;
+    }
+
+    days = days_from_civil(year, month, day);
+    return true;
+}
+
+/**
+ * @brief Checks if text is an integer that prints back identically (no '+', leading zeros or spaces).
+ *
+ * @param value The trimmed text.
+ * @return size_t Number of digits, or 0 if the text is not a canonical integer.
+ */
+static size_t canonical_int_digits(std::string_view value) {
+    const bool negative = !value.empty() && value.front() == '-';
+    if (negative) value.remove_prefix(1);
+    if (value.empty() || (value.front() == '0' && (value.size() > 1 || negative))) return 0;
+
+    for (const char c : value) {
+        if (c < '0' || c > '9') return 0;
+    }
+    return value.size();
+}
+
+/**
+ * @brief Parses decimal text (e.g. "-1234.5") into an unscaled value at the given scale.
+ *
+ * Values with more nonzero fractional digits than the scale, or more digits
+ * than the precision, are rejected rather than rounded; extra trailing zeros
+ * ("1.50" at scale 1) are dropped. Text without any digit ("-", ".") is not
+ * a number.
+ *
+ * @param str Pointer to the trimmed text.
+ * @param len Length of the text.
+ * @param type The target decimal type.
+ * @param out Receives the unscaled value.
+ * @return true If the text is a decimal that fits the type.
+ */
+static bool parse_decimal(const char* str, const size_t len, const arrow::Decimal128Type& type, arrow::Decimal128& out) {
+    const char* p = str;
+    const char* end = str + len;
+    const bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) p++;
+
+    int64_t unscaled = 0;
+    int digits = 0;
+    int fraction_digits = -1;
+    bool any_digit = false;
+    for (; p < end; p++) {
+        if (*p == '.' && fraction_digits < 0) {
+            fraction_digits = 0;
+            continue;
+        }
+        if (*p < '0' || *p > '9') return false;
+        any_digit = true;
+        if (digits == 18) break;
+        unscaled = unscaled * 10 + (*p - '0');
+        if (unscaled > 0) digits++;
+        if (fraction_digits >= 0) fraction_digits++;
+    }
+    if (!any_digit) return false;
+    if (fraction_digits < 0) fraction_digits = 0;
+
+    if (p < end) {
+        // More than 18 significant digits: leave it to Arrow's arbitrary-length parser.
+        int32_t precision, scale;
+        if (!arrow::Decimal128::FromString(std::string_view(str, len), &out, &precision, &scale).ok()) return false;
+        auto rescaled = out.Rescale(scale, type.scale());
+        if (!rescaled.ok()) return false;
+        out = *rescaled;
+    } else {
+        for (; fraction_digits > type.scale() && unscaled % 10 == 0; fraction_digits--) unscaled /= 10;
+        if (fraction_digits > type.scale()) return false;
+        out = arrow::Decimal128(negative ? -unscaled : unscaled) * arrow::Decimal128::GetScaleMultiplier(type.scale() - fraction_digits);
+    }
+
+    return out.FitsInPrecision(type.precision());
+}
+
+/**
+ * @brief Scans a character column and picks the narrowest lossless type for it.
+ *
+ * A column becomes date32 when every non-blank value is a valid 8-digit date in
+ * a single digit order, int32/int64 when every value is a canonical integer,
+ * and a dictionary when it has few distinct values. Otherwise it stays utf8.
+ * The scan stops as soon as no upgrade is possible any more.
+ *
+ * @param dbf The DBF file structure.
+ * @param col The column index.
+ * @param spec The column spec to update.
+ */
+static void infer_text_column(const DBF& dbf, const int col, ColumnSpec& spec) {
+    constexpr size_t max_dictionary_size = 1024;
+
+    const size_t record_length = dbf.header->record_length;
+    const size_t field_length = dbf.fields[col].field_length;
+    const char* field_data = reinterpret_cast<const char*>(dbf.mem_buffer.data() + dbf.header->header_length + dbf.fields[col].field_offset);
+
+    bool maybe_ymd = field_length >= 8;
+    bool maybe_dmy = field_length >= 8;
+    bool maybe_int = true;
+    size_t max_digits = 0;
+    size_t non_null = 0;
+    std::unordered_set<std::string_view> distinct;
+
+    const int64_t rows = dbf.header->records;
+    for (int64_t row = 0; row < rows; row++, field_data += record_length) {
+        const std::string_view value = trim_view(field_data, field_length);
+        if (value.empty()) continue;
+        non_null++;
+
+        int32_t days;
+        if (maybe_ymd) maybe_ymd = parse_date(value.data(), value.size(), DateOrder::YMD, true, days);
+        if (maybe_dmy) maybe_dmy = parse_date(value.data(), value.size(), DateOrder::DMY, true, days);
+        if (maybe_int) {
+            const size_t digits = canonical_int_digits(value);
+            maybe_int = digits > 0 && digits <= 18;
+            max_digits = std::max(max_digits, digits);
+        }
+        if (distinct.size() <= max_dictionary_size) distinct.insert(value);
+
+        if (!maybe_ymd && !maybe_dmy && !maybe_int && distinct.size() > max_dictionary_size) return;
+    }
+
+    if (non_null == 0) return;
+
+    if (maybe_ymd || maybe_dmy) {
+        spec.type = arrow::date32();
+        spec.date_order = maybe_ymd ? DateOrder::YMD : DateOrder::DMY;
+    } else if (maybe_int) {
+        spec.type = (max_digits <= 9) ? arrow::int32() : arrow::int64();
+    } else if (distinct.size() <= max_dictionary_size && distinct.size() * 4 <= non_null) {
+        spec.type = arrow::dictionary(arrow::int32(), arrow::utf8());
+    }
+}
+
+/**
+ * @brief Runs infer_text_column() over every character column in parallel.
+ *
+ * @param dbf The DBF file structure.
+ * @param specs The column specs to update.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status infer_column_types(const DBF& dbf, std::vector<ColumnSpec>& specs) {
+    std::vector<int> text_columns;
+    for (int col = 0; col < static_cast<int>(specs.size()); col++) {
+        if (dbf.fields[col].field_type == 'C' && !specs[col].pinned && specs[col].type->id() == arrow::Type::STRING) text_columns.push_back(col);
+    }
+
+    return arrow::internal::ParallelFor(static_cast<int>(text_columns.size()), [&](const int i) {
+        infer_text_column(dbf, text_columns[i], specs[text_columns[i]]);
+        return arrow::Status::OK();
+    });
+}
+
+/**
+ * @brief Applies a schema file override to a column spec.
+ *
+ * @param field The field descriptor.
+ * @param column The override from the schema file.
+ * @param spec The column spec to update.
+ * @return arrow::Status Invalid if the override cannot apply to this field.
+ */
+static arrow::Status apply_column_override(const DB_FIELD& field, const ColumnOverride& column, ColumnSpec& spec) {
+    const auto field_name = std::string(reinterpret_cast<const char*>(field.field_name));
+    if (is_binary_field(field)) {
+        return arrow::Status::Invalid("schema file: column '", field_name, "' is a binary '", static_cast<char>(field.field_type), "' field and cannot be overridden");
+    }
+
+    spec.pinned = true;
+    spec.null_values = column.null_values;
+    if (!column.type) return arrow::Status::OK();
+
+    switch (*column.type) {
+        case OverrideType::String:
+            spec.type = column.dictionary ? arrow::dictionary(arrow::int32(), arrow::utf8()) : arrow::utf8();
+            break;
+        case OverrideType::Int32: spec.type = arrow::int32(); break;
+        case OverrideType::Int64: spec.type = arrow::int64(); break;
+        case OverrideType::Float64: spec.type = arrow::float64(); break;
+        case OverrideType::Decimal: {
+            const int precision = column.precision > 0 ? column.precision : std::min<int>(field.field_length, 38);
+            const int scale = column.scale >= 0 ? column.scale : field.field_decimals;
+            if (scale > precision) return arrow::Status::Invalid("schema file: column '", field_name, "' has a decimal scale above its precision");
+            spec.type = arrow::decimal128(precision, scale);
+            break;
+        }
+        case OverrideType::Date32:
+            spec.type = arrow::date32();
+            spec.date_order = column.day_first ? DateOrder::DMY : DateOrder::YMD;
+            break;
+        case OverrideType::Boolean: spec.type = arrow::boolean(); break;
+    }
+    return arrow::Status::OK();
+}
+
 /**
  * @brief Creates an Arrow schema based on the DBF file structure.
  *
  * @param dbf The DBF file structure.
+ * @param options Conversion options (schema overrides, type inference).
+ * @param specs Receives the decoding plan of every column.
  * @return std::shared_ptr<arrow::Schema> The created Arrow schema.
  */
-static std::shared_ptr<arrow::Schema> create_schema(const DBF &dbf) {
-    std::vector<std::shared_ptr<arrow::Field>> fields;
+static arrow::Result<std::shared_ptr<arrow::Schema>> create_schema(const DBF &dbf, const ConvertOptions& options, std::vector<ColumnSpec>& specs) {
     const unsigned int cols = dbf_NumCols(dbf);
 
+    specs.assign(cols, ColumnSpec{});
     for (unsigned int i = 0; i < cols; i++) {
-        const auto field_name = std::string(reinterpret_cast<const char*>(dbf.fields[i].field_name));
+        specs[i].type = field_arrow_type(dbf.fields[i]);
 
-        switch (dbf.fields[i].field_type) {
-            case 'C': fields.push_back(arrow::field(field_name, arrow::utf8())); break;
-            case 'N':
-                if (dbf.fields[i].field_decimals > 0) {
-                    fields.push_back(arrow::field(field_name, arrow::float64()));
-                } else {
-                    if (dbf.fields[i].field_length <= 9) {
-                        fields.push_back(arrow::field(field_name, arrow::int32()));
-                    } else {
-                        fields.push_back(arrow::field(field_name, arrow::int64()));
-                    }
-                }
-                break;
-            case 'D': fields.push_back(arrow::field(field_name, arrow::date32())); break;
-            case 'L': fields.push_back(arrow::field(field_name, arrow::boolean())); break;
-            default: fields.push_back(arrow::field(field_name, arrow::utf8())); break;
-        }
+        if (!options.schema_overrides) continue;
+        const auto& overrides = options.schema_overrides->columns;
+        const auto it = overrides.find(reinterpret_cast<const char*>(dbf.fields[i].field_name));
+        if (it != overrides.end()) ARROW_RETURN_NOT_OK(apply_column_override(dbf.fields[i], it->second, specs[i]));
+    }
+
+    if (options.infer_types) ARROW_RETURN_NOT_OK(infer_column_types(dbf, specs));
+
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (unsigned int i = 0; i < cols; i++) {
+        const auto field_name = std::string(reinterpret_cast<const char*>(dbf.fields[i].field_name));
+        fields.push_back(arrow::field(field_name, specs[i].type));
     }
     return arrow::schema(fields);
 }
@@ -118,15 +490,16 @@ inline UINT get_windows_codepage(const std::string& encoding) {
  * @param in_len Length of the input string.
  * @param codepage The Windows codepage identifier.
  * @param buffer A vector to store the converted string.
+ * @param wide_buffer Scratch vector for the intermediate UTF-16 string.
  * @return std::string_view The converted UTF-8 string.
  */
-inline std::string_view convert_to_utf8_opt(const char* input, const size_t in_len, const UINT codepage, std::vector<char>& buffer) {
+inline std::string_view convert_to_utf8_opt(const char* input, const size_t in_len, const UINT codepage, std::vector<char>& buffer, std::vector<wchar_t>& wide_buffer) {
     if (in_len == 0) return {};
 
     int wide_len = MultiByteToWideChar(codepage, 0, input, static_cast<int>(in_len), nullptr, 0);
     if (wide_len == 0) return {};
 
-    std::vector<wchar_t> wide_buffer(wide_len);
+    if (wide_buffer.size() < static_cast<size_t>(wide_len)) wide_buffer.resize(wide_len);
     if (MultiByteToWideChar(codepage, 0, input, static_cast<int>(in_len), wide_buffer.data(), wide_len) == 0) return {};
 
     int utf8_len = WideCharToMultiByte(CP_UTF8, 0, wide_buffer.data(), wide_len, nullptr, 0, nullptr, nullptr);
@@ -169,183 +542,2476 @@ inline std::string_view convert_to_utf8_opt(const char* input, const size_t in_l
 #endif
 
 /**
- * @brief Trims whitespace from the beginning and end of a string in-place.
+ * @brief Checks if a trimmed value is one of the column's null sentinels.
+ */
+static inline bool is_null_value(const std::vector<std::string>& null_values, const char* str, const size_t len) {
+    for (const auto& null_value : null_values) {
+        if (null_value.size() == len && memcmp(null_value.data(), str, len) == 0) return true;
+    }
+    return false;
+}
+
+static inline uint32_t bswap32(const uint32_t v) {
+#ifdef _MSC_VER
+    return _byteswap_ulong(v);
+#else
+    return __builtin_bswap32(v);
+#endif
+}
+
+static inline uint64_t bswap64(const uint64_t v) {
+#ifdef _MSC_VER
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+/**
+ * @brief Copies a fixed-size binary value out of every record.
  *
- * @param start Pointer to the start of the string.
- * @param len Length of the string, will be updated after trimming.
- * @return char* Pointer to the trimmed string.
+ * @param records Pointers to the start of each record in the batch.
+ * @param n The number of records.
+ * @param offset Byte offset of the field inside the record.
+ * @param out Destination array, one element per record.
  */
-inline char* trim_in_place(char* start, size_t& len) {
-    if (len == 0) return start;
+template <typename T>
+static void gather_fixed(const unsigned char* const* records, const size_t n, const size_t offset, T* out) {
+    for (size_t i = 0; i < n; ++i) memcpy(&out[i], records[i] + offset, sizeof(T));
+}
 
-    char* end = start + len - 1;
+/**
+ * @brief Converts dBASE 7 integers (big-endian, sign bit flipped) to host order in place.
+ */
+static void decode_dbase7_int32(uint32_t* values, const size_t n) {
+    for (size_t i = 0; i < n; ++i) values[i] = bswap32(values[i]) ^ 0x80000000u;
+}
 
-    while (start <= end && isspace(static_cast<unsigned char>(*start))) {
-        start++;
-        len--;
-    }
-    while (end > start && isspace(static_cast<unsigned char>(*end))) {
-        end--;
-        len--;
+/**
+ * @brief Converts dBASE 7 doubles to host order in place.
+ *
+ * Positive values are stored with the sign bit set and negative values with
+ * every bit inverted, so that the raw bytes sort like the numbers they hold.
+ */
+static void decode_dbase7_double(uint64_t* values, const size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t v = bswap64(values[i]);
+        values[i] = (v & 0x8000000000000000ull) ? (v ^ 0x8000000000000000ull) : ~v;
     }
+}
+
+/**
+ * @brief Decodes a binary DBF column (I, +, B, O, Y, T, @) into an Arrow builder.
+ *
+ * Values are copied out of the records in one pass and converted to host order
+ * in a second, so both loops stay branch-free and easy to vectorize.
+ *
+ * @param builder The builder matching the column type in the schema.
+ * @param field_def The field descriptor.
+ * @param records Pointers to the start of each record in the batch.
+ * @param n The number of records.
+ * @param dbase7 Whether the table uses the dBASE 7 binary layout.
+ * @param scratch Reusable buffer holding one 8-byte slot per record.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status append_binary_column(arrow::ArrayBuilder* builder, const DB_FIELD& field_def,
+                                          const unsigned char* const* records, const size_t n, const bool dbase7,
+                                          std::vector<uint64_t>& scratch) {
+    const size_t offset = field_def.field_offset;
+    if (scratch.size() < n) scratch.resize(n);
 
-    *(end + 1) = '\0';
+    switch (field_def.field_type) {
+        case 'I': case '+': {
+            auto* values = reinterpret_cast<uint32_t*>(scratch.data());
+            gather_fixed(records, n, offset, values);
+            if (dbase7) decode_dbase7_int32(values, n);
+            return static_cast<arrow::Int32Builder*>(builder)->AppendValues(reinterpret_cast<const int32_t*>(values), static_cast<int64_t>(n));
+        }
+        case 'B': case 'O': {
+            uint64_t* values = scratch.data();
+            gather_fixed(records, n, offset, values);
+            if (dbase7) decode_dbase7_double(values, n);
+            return static_cast<arrow::DoubleBuilder*>(builder)->AppendValues(reinterpret_cast<const double*>(values), static_cast<int64_t>(n));
+        }
+        case 'Y': {
+            auto* values = reinterpret_cast<int64_t*>(scratch.data());
+            gather_fixed(records, n, offset, values);
+            auto* decimal_builder = static_cast<arrow::Decimal128Builder*>(builder);
+            ARROW_RETURN_NOT_OK(decimal_builder->Reserve(static_cast<int64_t>(n)));
+            for (size_t i = 0; i < n; ++i) decimal_builder->UnsafeAppend(arrow::Decimal128(values[i]));
+            return arrow::Status::OK();
+        }
+        default: {
+            // T and @: Julian day number followed by milliseconds since midnight.
+            gather_fixed(records, n, offset, scratch.data());
+            auto* values = reinterpret_cast<uint32_t*>(scratch.data());
+            if (dbase7) decode_dbase7_int32(values, n * 2);
 
-    return start;
+            auto* ts_builder = static_cast<arrow::TimestampBuilder*>(builder);
+            ARROW_RETURN_NOT_OK(ts_builder->Reserve(static_cast<int64_t>(n)));
+            constexpr int64_t unix_epoch_julian_day = 2440588;
+            constexpr int64_t ms_per_day = 86400000;
+            for (size_t i = 0; i < n; ++i) {
+                const auto julian_day = static_cast<int32_t>(values[2 * i]);
+                const auto ms = static_cast<int32_t>(values[2 * i + 1]);
+                // Blank datetimes are stored as zeros or spaces.
+                if (julian_day <= 0 || values[2 * i] == 0x20202020u) ts_builder->UnsafeAppendNull();
+                else ts_builder->UnsafeAppend((julian_day - unix_epoch_julian_day) * ms_per_day + ms);
+            }
+            return arrow::Status::OK();
+        }
+    }
 }
 
 
+#ifndef _WIN32
+/*! Idle iconv descriptors, keyed by source encoding. */
+struct IconvCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<iconv_t>> idle;
+};
+
+/*! descriptors kept per encoding; more than the slots of a few concurrent files is never needed */
+static constexpr size_t kMaxIdleIconv = 256;
+
+static IconvCache& iconv_cache() {
+    // Never destroyed, so slots released during static destruction still find it.
+    static IconvCache* cache = new IconvCache();
+    return *cache;
+}
+
 /**
- * @brief Creates an Arrow RecordBatch from a subset of DBF records.
+ * @brief Takes an iconv descriptor to UTF-8, reusing an idle one when possible.
  *
- * @param dbf The DBF file structure.
- * @param schema The Arrow schema to use.
- * @param start_row The starting row index in the DBF file.
- * @param num_rows The number of rows to include in the batch.
- * @return std::shared_ptr<arrow::RecordBatch> The created Arrow RecordBatch.
+ * iconv_open() loads the conversion tables of the code page on every call.
+ * Long-running processes (multi-file runs, --daemon) convert thousands of
+ * files in the same few encodings, so descriptors are kept warm instead of
+ * being closed after each file.
+ *
+ * @param encoding The source encoding.
+ * @return iconv_t The descriptor, or (iconv_t)-1 on failure.
  */
-arrow::Result<std::shared_ptr<arrow::RecordBatch>> create_arrow_batch(DBF& dbf, const std::shared_ptr<arrow::Schema>& schema, const int start_row, const int num_rows) {
-    std::vector<std::shared_ptr<arrow::Array>> columns;
-    const unsigned int actual_rows = (start_row + num_rows > dbf.header->records) ? dbf.header->records - start_row : num_rows;
-
-    std::vector<unsigned char*> record_pointers(actual_rows);
-    for (int i = 0; i < actual_rows; ++i) {
-        record_pointers[i] = dbf.mem_buffer.data() + dbf.header->header_length + ((start_row + i) * dbf.header->record_length);
+static iconv_t acquire_iconv(const std::string& encoding) {
+    {
+        IconvCache& cache = iconv_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.idle.find(encoding);
+        if (it != cache.idle.end() && !it->second.empty()) {
+            iconv_t cd = it->second.back();
+            it->second.pop_back();
+            return cd;
+        }
     }
+    return iconv_open("UTF-8", encoding.c_str());
+}
 
-    std::vector<char> conv_buffer(1024);
+/**
+ * @brief Hands a descriptor back to the cache, reset to its initial state.
+ */
+static void release_iconv(const std::string& encoding, iconv_t cd) {
+    iconv(cd, nullptr, nullptr, nullptr, nullptr);
+    {
+        IconvCache& cache = iconv_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto& idle = cache.idle[encoding];
+        if (idle.size() < kMaxIdleIconv) {
+            idle.push_back(cd);
+            return;
+        }
+    }
+    iconv_close(cd);
+}
+#endif
 
-    // Platform-specific setup for encoding conversion
+/**
+ * @brief Decoder state of one column, or of one row slice of a wide column.
+ *
+ * Every slot owns its builder, scratch buffers and iconv descriptor, so the
+ * slots of a batch can be decoded on different threads. Builders are created
+ * once and handed back empty by Finish(), and the buffers keep their capacity
+ * between batches, so the per-batch hot loop does not allocate beyond the
+ * output arrays themselves.
+ */
+struct DecodeSlot {
+    /*! column decoded by this slot */
+    int column = 0;
+    /*! index of this slot's row slice */
+    int part = 0;
+    /*! number of row slices the column is split into */
+    int parts = 1;
+    /*! builder for the column type, reset by Finish() (and ResetFull() for dictionaries) after each batch */
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+    /*! output of the last decoded batch */
+    std::shared_ptr<arrow::Array> array;
+    /*! UTF-8 output of the encoding conversion */
+    std::vector<char> conv_buffer;
+    /*! one 8-byte slot per record for binary field decoding */
+    std::vector<uint64_t> binary_scratch;
 #ifdef _WIN32
-    UINT codepage = get_windows_codepage(dbf.encoding);
+    std::vector<wchar_t> wide_buffer;
 #else
-    iconv_t conv_desc = iconv_open("UTF-8", dbf.encoding.c_str());
-    if (conv_desc == (iconv_t)-1) return arrow::Status::Invalid("Failed to initialize encoding conversion (iconv_open).");
+    /*! source encoding of conv_desc, to return it to the cache */
+    std::string encoding;
+    iconv_t conv_desc = reinterpret_cast<iconv_t>(-1);
+#endif
+
+    DecodeSlot() = default;
+    DecodeSlot(const DecodeSlot&) = delete;
+    DecodeSlot& operator=(const DecodeSlot&) = delete;
+
+    ~DecodeSlot() {
+#ifndef _WIN32
+        if (conv_desc != reinterpret_cast<iconv_t>(-1)) release_iconv(encoding, conv_desc);
 #endif
+    }
+};
 
-    for (int col = 0; col < schema->num_fields(); col++) {
-        std::unique_ptr<arrow::ArrayBuilder> builder;
-        ARROW_RETURN_NOT_OK(arrow::MakeBuilder(arrow::default_memory_pool(), schema->field(col)->type(), &builder));
+/**
+ * @brief Per-conversion state shared by every batch of one DBF file.
+ */
+struct BatchContext {
+    /*! decoding plan of every column */
+    std::vector<ColumnSpec> specs;
+    /*! decode slots, ordered by column and then by row slice */
+    std::vector<std::unique_ptr<DecodeSlot>> slots;
+    /*! start of each record of the current batch */
+    std::vector<const unsigned char*> record_pointers;
+    /*! pool used to join the row slices of split columns */
+    arrow::MemoryPool* pool = nullptr;
+    /*! whether binary fields use the dBASE 7 layout */
+    bool dbase7 = false;
+#ifdef _WIN32
+    UINT codepage = 0;
+#endif
+};
 
-        const auto& field_def = dbf.fields[col];
-        const size_t field_offset = field_def.field_offset;
-        const size_t field_length = field_def.field_length;
-        auto field_type_id = schema->field(col)->type()->id();
+/**
+ * @brief Decides how many row slices a column is decoded in.
+ *
+ * Columns are independent, so a batch is decoded as one task per column on
+ * the CPU thread pool. A column whose decode cost is well above an even share
+ * of the batch (a long text field next to many short codes) is split into row
+ * slices, so it does not finish long after every other column.
+ *
+ * @param dbf The DBF file structure.
+ * @param specs The decoding plan of every column.
+ * @param batch_size The number of rows per batch.
+ * @return std::vector<int> The number of row slices of each column.
+ */
+static std::vector<int> plan_column_slices(const DBF& dbf, const std::vector<ColumnSpec>& specs, const int batch_size) {
+    constexpr int min_rows_per_slice = 2048;
 
-        for (int i = 0; i < actual_rows; i++) {
-            char* field_data = reinterpret_cast<char*>(record_pointers[i] + field_offset);
+    const int threads = arrow::GetCpuThreadPoolCapacity();
+    std::vector<int> slices(specs.size(), 1);
+    if (threads <= 1 || batch_size < 2 * min_rows_per_slice) return slices;
 
-            const char backup_char = field_data[field_length];
-            field_data[field_length] = '\0';
+    // Relative per-row cost: text is trimmed and parsed byte by byte, binary fields are plain copies.
+    std::vector<size_t> costs(specs.size());
+    size_t total_cost = 0;
+    for (size_t col = 0; col < specs.size(); col++) {
+        costs[col] = is_binary_field(dbf.fields[col]) ? 2 : dbf.fields[col].field_length + 8;
+        total_cost += costs[col];
+    }
 
-            size_t current_len = field_length;
-            char* trimmed_data = trim_in_place(field_data, current_len);
+    const size_t fair_share = std::max<size_t>(1, total_cost / threads);
+    const int max_slices = std::min(threads, batch_size / min_rows_per_slice);
+    for (size_t col = 0; col < specs.size(); col++) {
+        // Dictionary slices would carry different dictionaries, which cannot simply be concatenated.
+        if (specs[col].type->id() == arrow::Type::DICTIONARY) continue;
+        const size_t wanted = (costs[col] + fair_share - 1) / fair_share;
+        slices[col] = static_cast<int>(std::clamp<size_t>(wanted, 1, max_slices));
+    }
+    return slices;
+}
 
-            if (*trimmed_data == '\0') ARROW_RETURN_NOT_OK(builder->AppendNull());
-            else {
-                switch (field_type_id) {
-                    case arrow::Type::STRING: {
-                        if (is_ascii(trimmed_data, current_len)) ARROW_RETURN_NOT_OK(static_cast<arrow::StringBuilder*>(builder.get())->Append(trimmed_data, current_len));
-                        else {
+/**
+ * @brief Creates the batch context for a DBF file and its schema.
+ *
+ * @param dbf The DBF file structure.
+ * @param schema The Arrow schema to use.
+ * @param specs The decoding plan of every column.
+ * @param batch_size The number of rows per batch.
+ * @param pool Memory pool for the builders.
+ * @param columns DBF column of each schema field; empty when they match one to one.
+ * @return std::unique_ptr<BatchContext> The initialized context.
+ */
+static arrow::Result<std::unique_ptr<BatchContext>> make_batch_context(const DBF& dbf, const std::shared_ptr<arrow::Schema>& schema, std::vector<ColumnSpec> specs, const int batch_size, arrow::MemoryPool* pool,
+                                                                       std::vector<int> columns = {}) {
+    auto ctx = std::make_unique<BatchContext>();
+    ctx->specs = std::move(specs);
+    ctx->pool = pool;
+    ctx->dbase7 = is_dbase7(dbf);
 #ifdef _WIN32
-                            std::string_view utf8_view = convert_to_utf8_opt(trimmed_data, current_len, codepage, conv_buffer);
-#else
-                            std::string_view utf8_view = convert_to_utf8_opt(trimmed_data, current_len, conv_desc, conv_buffer);
+    ctx->codepage = get_windows_codepage(dbf.encoding);
 #endif
-                            ARROW_RETURN_NOT_OK(static_cast<arrow::StringBuilder*>(builder.get())->Append(utf8_view));
-                        }
-                        break;
-                    }
-                    case arrow::Type::INT32: {
-                        int32_t value;
-                        if (std::from_chars(trimmed_data, trimmed_data + current_len, value).ec == std::errc())
-                            ARROW_RETURN_NOT_OK(static_cast<arrow::Int32Builder*>(builder.get())->Append(value));
-                        else ARROW_RETURN_NOT_OK(builder->AppendNull());
-                        break;
-                    }
-                    case arrow::Type::INT64: {
-                        int64_t value;
-                        if (std::from_chars(trimmed_data, trimmed_data + current_len, value).ec == std::errc())
-                            ARROW_RETURN_NOT_OK(static_cast<arrow::Int64Builder*>(builder.get())->Append(value));
-                        else ARROW_RETURN_NOT_OK(builder->AppendNull());
-                        break;
-                    }
-                    case arrow::Type::DOUBLE: {
-                        double value;
-                        if (fast_float::from_chars(trimmed_data, trimmed_data + current_len, value).ec == std::errc())
-                            ARROW_RETURN_NOT_OK(static_cast<arrow::DoubleBuilder*>(builder.get())->Append(value));
-                        else ARROW_RETURN_NOT_OK(builder->AppendNull());
-                        break;
-                    }
-                    case arrow::Type::BOOL: {
-                        bool value = (current_len == 1 && (*trimmed_data == 'T' || *trimmed_data == 't' || *trimmed_data == '1' || *trimmed_data == 'Y' || *trimmed_data == 'y'));
-                        ARROW_RETURN_NOT_OK(static_cast<arrow::BooleanBuilder*>(builder.get())->Append(value));
-                        break;
-                    }
-                    case arrow::Type::DATE32: {
-                        int year, month, day;
-                        if (sscanf(trimmed_data, "%4d%2d%2d", &year, &month, &day) == 3) {
-                            struct tm tm = {0};
-                            tm.tm_year = year - 1900;
-                            tm.tm_mon = month - 1;
-                            tm.tm_mday = day;
-                            const time_t epoch_seconds = mktime(&tm);
-                            const auto days_since_epoch = static_cast<int32_t>(epoch_seconds / (24 * 60 * 60));
-                            ARROW_RETURN_NOT_OK(static_cast<arrow::Date32Builder*>(builder.get())->Append(days_since_epoch));
-                        } else ARROW_RETURN_NOT_OK(builder->AppendNull());
-                        break;
-                    }
-                    default:
-                        ARROW_RETURN_NOT_OK(builder->AppendNull());
-                        break;
-                }
-            }
-            field_data[field_length] = backup_char;
-        }
 
-        std::shared_ptr<arrow::Array> array;
-        ARROW_RETURN_NOT_OK(builder->Finish(&array));
-        columns.push_back(array);
+    if (columns.empty()) {
+        for (int col = 0; col < schema->num_fields(); col++) columns.push_back(col);
     }
 
+    const std::vector<int> slices = plan_column_slices(dbf, ctx->specs, batch_size);
+    for (int field = 0; field < schema->num_fields(); field++) {
+        const int col = columns[field];
+        const auto& type = schema->field(field)->type();
+        const bool is_text = !is_binary_field(dbf.fields[col]) && (type->id() == arrow::Type::STRING || type->id() == arrow::Type::DICTIONARY);
+
+        for (int part = 0; part < slices[col]; part++) {
+            auto slot = std::make_unique<DecodeSlot>();
+            slot->column = col;
+            slot->part = part;
+            slot->parts = slices[col];
+
+            // Dictionary columns need a concrete int32 index builder; MakeBuilder() would adapt the index width per batch.
+            if (type->id() == arrow::Type::DICTIONARY) slot->builder = std::make_unique<arrow::StringDictionary32Builder>(pool);
+            else ARROW_RETURN_NOT_OK(arrow::MakeBuilder(pool, type, &slot->builder));
+
+            if (is_text) {
+                // Worst case of a single-byte code page to UTF-8 is 4 bytes per character.
+                slot->conv_buffer.resize(std::max<size_t>(1024, dbf.fields[col].field_length * 4));
 #ifndef _WIN32
-    iconv_close(conv_desc);
+                slot->encoding = dbf.encoding;
+                slot->conv_desc = acquire_iconv(dbf.encoding);
+                if (slot->conv_desc == reinterpret_cast<iconv_t>(-1)) return arrow::Status::Invalid("Failed to initialize encoding conversion (iconv_open).");
 #endif
+            }
+            ctx->slots.push_back(std::move(slot));
+        }
+    }
 
-    return arrow::RecordBatch::Make(schema, actual_rows, columns);
+    return ctx;
 }
 
-
-
 /**
- * @brief Writes the contents of a DBF file to a Parquet file.
+ * @brief Decodes one column over a range of records into the slot's builder.
+ *
+ * The records are only read: fields are trimmed and parsed by length, never
+ * terminated in place, so slots may run concurrently over the same buffer.
  *
  * @param dbf The DBF file structure.
- * @param path The output path for the Parquet file.
- * @param batch_size The number of rows to process in each batch.
- * @return true If the Parquet file was successfully written.
- * @return false If an error occurred during the writing process.
+ * @param ctx The batch context.
+ * @param slot The decode slot.
+ * @param records Pointers to the start of each record to decode.
+ * @param num_records The number of records.
+ * @return arrow::Status OK on success.
  */
-arrow::Status write_parquet(DBF& dbf, const std::string& path, const int batch_size) {
-    auto schema = create_schema(dbf);
-    if (!schema) return arrow::Status::Invalid("Schema creation failed.");
+static arrow::Status decode_slot(const DBF& dbf, const BatchContext& ctx, DecodeSlot& slot, const unsigned char* const* records, const int64_t num_records) {
+    const int col = slot.column;
+    arrow::ArrayBuilder* builder = slot.builder.get();
+    ARROW_RETURN_NOT_OK(builder->Reserve(num_records));
 
-    ARROW_ASSIGN_OR_RAISE(const auto outfile, arrow::io::FileOutputStream::Open(path));
+    const auto& field_def = dbf.fields[col];
+    if (is_binary_field(field_def)) {
+        ARROW_RETURN_NOT_OK(append_binary_column(builder, field_def, records, static_cast<size_t>(num_records), ctx.dbase7, slot.binary_scratch));
+        return builder->Finish(&slot.array);
+    }
 
-    parquet::WriterProperties::Builder props_builder;
-    props_builder.compression(parquet::Compression::ZSTD);
-    auto writer_properties = props_builder.build();
+    const size_t field_offset = field_def.field_offset;
+    const size_t field_length = field_def.field_length;
+    const auto field_type_id = builder->type()->id();
+    const DateOrder date_order = ctx.specs[col].date_order;
+    const std::vector<std::string>& null_values = ctx.specs[col].null_values;
 
-    std::shared_ptr<parquet::arrow::FileWriter> writer;
-    ARROW_ASSIGN_OR_RAISE(writer, parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), outfile, writer_properties));
+    for (int64_t i = 0; i < num_records; i++) {
+        const std::string_view trimmed = trim_view(reinterpret_cast<const char*>(records[i] + field_offset), field_length);
+        const char* trimmed_data = trimmed.data();
+        const size_t current_len = trimmed.size();
 
-    for (int start = 0; start < dbf.header->records; start += batch_size) {
-        ARROW_ASSIGN_OR_RAISE(auto record_batch, create_arrow_batch(dbf, schema, start, batch_size));
-        ARROW_RETURN_NOT_OK(writer->WriteRecordBatch(*record_batch));
+        if (current_len == 0 || *trimmed_data == '\0' || is_null_value(null_values, trimmed_data, current_len)) ARROW_RETURN_NOT_OK(builder->AppendNull());
+        else {
+            switch (field_type_id) {
+                case arrow::Type::STRING:
+                case arrow::Type::DICTIONARY: {
+                    std::string_view text = trimmed;
+                    if (!is_ascii(trimmed_data, current_len)) {
+#ifdef _WIN32
+                        text = convert_to_utf8_opt(trimmed_data, current_len, ctx.codepage, slot.conv_buffer, slot.wide_buffer);
+#else
+                        text = convert_to_utf8_opt(trimmed_data, current_len, slot.conv_desc, slot.conv_buffer);
+#endif
+                    }
+                    if (field_type_id == arrow::Type::STRING) ARROW_RETURN_NOT_OK(static_cast<arrow::StringBuilder*>(builder)->Append(text));
+                    else ARROW_RETURN_NOT_OK(static_cast<arrow::StringDictionary32Builder*>(builder)->Append(text));
+                    break;
+                }
+                case arrow::Type::INT32: {
+                    int32_t value = 0;
+                    if (std::from_chars(trimmed_data, trimmed_data + current_len, value).ec == std::errc())
+                        ARROW_RETURN_NOT_OK(static_cast<arrow::Int32Builder*>(builder)->Append(value));
+                    else ARROW_RETURN_NOT_OK(builder->AppendNull());
+                    break;
+                }
+                case arrow::Type::INT64: {
+                    int64_t value = 0;
+                    if (std::from_chars(trimmed_data, trimmed_data + current_len, value).ec == std::errc())
+                        ARROW_RETURN_NOT_OK(static_cast<arrow::Int64Builder*>(builder)->Append(value));
+                    else ARROW_RETURN_NOT_OK(builder->AppendNull());
+                    break;
+                }
+                case arrow::Type::DOUBLE: {
+                    double value = 0;
+                    if (fast_float::from_chars(trimmed_data, trimmed_data + current_len, value).ec == std::errc())
+                        ARROW_RETURN_NOT_OK(static_cast<arrow::DoubleBuilder*>(builder)->Append(value));
+                    else ARROW_RETURN_NOT_OK(builder->AppendNull());
+                    break;
+                }
+                case arrow::Type::DECIMAL128: {
+                    arrow::Decimal128 value;
+                    auto* decimal_builder = static_cast<arrow::Decimal128Builder*>(builder);
+                    if (parse_decimal(trimmed_data, current_len, static_cast<const arrow::Decimal128Type&>(*decimal_builder->type()), value))
+                        ARROW_RETURN_NOT_OK(decimal_builder->Append(value));
+                    else ARROW_RETURN_NOT_OK(builder->AppendNull());
+                    break;
+                }
+                case arrow::Type::BOOL: {
+                    bool value = (current_len == 1 && (*trimmed_data == 'T' || *trimmed_data == 't' || *trimmed_data == '1' || *trimmed_data == 'Y' || *trimmed_data == 'y'));
+                    ARROW_RETURN_NOT_OK(static_cast<arrow::BooleanBuilder*>(builder)->Append(value));
+                    break;
+                }
+                case arrow::Type::DATE32: {
+                    int32_t days_since_epoch;
+                    if (parse_date(trimmed_data, current_len, date_order, false, days_since_epoch))
+                        ARROW_RETURN_NOT_OK(static_cast<arrow::Date32Builder*>(builder)->Append(days_since_epoch));
+                    else ARROW_RETURN_NOT_OK(builder->AppendNull());
+                    break;
+                }
+                default:
+                    ARROW_RETURN_NOT_OK(builder->AppendNull());
+                    break;
+            }
+        }
     }
 
-    ARROW_RETURN_NOT_OK(writer->Close());
-    ARROW_RETURN_NOT_OK(outfile->Close());
+    ARROW_RETURN_NOT_OK(builder->Finish(&slot.array));
+    // Finish() keeps a dictionary builder's memo table; clear it so each batch's dictionary holds only its own values.
+    if (field_type_id == arrow::Type::DICTIONARY) static_cast<arrow::StringDictionary32Builder*>(builder)->ResetFull();
+    return arrow::Status::OK();
+}
 
+/**
+ * @brief Creates an Arrow RecordBatch from a subset of DBF records.
+ *
+ * The decode slots run in parallel on the CPU thread pool; the batch is
+ * assembled once every column has been decoded.
+ *
+ * @param dbf The DBF file structure.
+ * @param schema The Arrow schema to use.
+ * @param ctx The reusable batch context created for this file and schema.
+ * @param start_row The starting row index in the DBF file, or in row_order.
+ * @param num_rows The number of rows to include in the batch.
+ * @param row_order Row numbers in output order, or nullptr for the file order.
+ * @return std::shared_ptr<arrow::RecordBatch> The created Arrow RecordBatch.
+ */
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> create_arrow_batch(const DBF& dbf, const std::shared_ptr<arrow::Schema>& schema, BatchContext& ctx, const int64_t start_row, const int64_t num_rows,
+                                                                      const uint32_t* row_order = nullptr) {
+    const int64_t total_rows = dbf.header->records;
+    const int64_t actual_rows = (start_row + num_rows > total_rows) ? total_rows - start_row : num_rows;
+
+    // All offset math in size_t: row * record_length passes 2^31 long before the last record of a multi-GB file.
+    const size_t record_length = dbf.header->record_length;
+    const unsigned char* records = dbf.mem_buffer.data() + dbf.header->header_length;
+
+    std::vector<const unsigned char*>& record_pointers = ctx.record_pointers;
+    record_pointers.resize(static_cast<size_t>(actual_rows));
+    if (row_order) {
+        for (size_t i = 0; i < record_pointers.size(); ++i) {
+            record_pointers[i] = records + static_cast<size_t>(row_order[start_row + i]) * record_length;
+        }
+    } else {
+        const unsigned char* first_record = records + static_cast<size_t>(start_row) * record_length;
+        for (size_t i = 0; i < record_pointers.size(); ++i) {
+            record_pointers[i] = first_record + i * record_length;
+        }
+    }
+
+    auto decode = [&](const int i) {
+        DecodeSlot& slot = *ctx.slots[i];
+        const int64_t begin = actual_rows * slot.part / slot.parts;
+        const int64_t end = actual_rows * (slot.part + 1) / slot.parts;
+        return decode_slot(dbf, ctx, slot, record_pointers.data() + begin, end - begin);
+    };
+
+    const int num_slots = static_cast<int>(ctx.slots.size());
+    if (num_slots > 1 && arrow::GetCpuThreadPoolCapacity() > 1) {
+        ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(num_slots, decode));
+    } else {
+        for (int i = 0; i < num_slots; i++) ARROW_RETURN_NOT_OK(decode(i));
+    }
+
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    columns.reserve(schema->num_fields());
+    for (int i = 0; i < num_slots; i += ctx.slots[i]->parts) {
+        const int parts = ctx.slots[i]->parts;
+        if (parts == 1) {
+            columns.push_back(std::move(ctx.slots[i]->array));
+            continue;
+        }
+
+        arrow::ArrayVector slices;
+        for (int part = 0; part < parts; part++) slices.push_back(std::move(ctx.slots[i + part]->array));
+        ARROW_ASSIGN_OR_RAISE(auto column, arrow::Concatenate(slices, ctx.pool));
+        columns.push_back(std::move(column));
+    }
+
+    return arrow::RecordBatch::Make(schema, actual_rows, columns);
+}
+
+/*! \struct OutputRows
+	\brief What one output file holds: which DBF columns, which rows, in what order
+*/
+struct OutputRows {
+    /*! schema of the file */
+    std::shared_ptr<arrow::Schema> schema;
+    /*! DBF column of each schema field */
+    std::vector<int> columns;
+    /*! row numbers in output order; nullptr for every row in file order */
+    const uint32_t* rows = nullptr;
+    /*! number of rows written */
+    int64_t num_rows = 0;
+};
+
+
+
+/**
+ * @brief Splits a compression setting into its codec, lowercased, and level.
+ *
+ * @param text The setting as typed; a bare level leaves the codec empty.
+ * @return arrow::Result<CompressionSpec> The codec and level, not yet checked.
+ */
+static arrow::Result<CompressionSpec> split_compression(const std::string& text) {
+    CompressionSpec spec;
+    std::string codec = text;
+    std::string level;
+    const size_t colon = text.find(':');
+    if (colon != std::string::npos) {
+        codec = text.substr(0, colon);
+        level = text.substr(colon + 1);
+    } else if (!text.empty() && text.find_first_not_of("-0123456789") == std::string::npos) {
+        codec.clear();
+        level = text;
+    }
+
+    if (!level.empty()) {
+        int value = 0;
+        const auto [end, ec] = std::from_chars(level.data(), level.data() + level.size(), value);
+        if (ec != std::errc() || end != level.data() + level.size())
+            return arrow::Status::Invalid("invalid compression level: ", level);
+        spec.level = value;
+    }
+    for (auto& c : codec) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (codec == "none") codec = "uncompressed";
+    spec.codec = codec;
+    return spec;
+}
+
+/**
+ * @brief Checks that a codec is built into this Arrow and that the level is in its range.
+ */
+static arrow::Status check_compression(const CompressionSpec& spec, const arrow::Compression::type type) {
+    if (!arrow::util::Codec::IsAvailable(type))
+        return arrow::Status::NotImplemented("compression codec not built into this Arrow: ", spec.codec);
+    if (spec.level) {
+        ARROW_ASSIGN_OR_RAISE(const int minimum, arrow::util::Codec::MinimumCompressionLevel(type));
+        ARROW_ASSIGN_OR_RAISE(const int maximum, arrow::util::Codec::MaximumCompressionLevel(type));
+        if (*spec.level < minimum || *spec.level > maximum)
+            return arrow::Status::Invalid(spec.codec, " level must be between ", minimum, " and ", maximum);
+    }
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Parses a Parquet compression setting such as "zstd", "zstd:19", "none" or "3".
+ *
+ * Arrow reads "lz4" as the LZ4 frame format, which Parquet does not write;
+ * it stands for Parquet's LZ4_RAW here. Codecs Parquet has no use for, such
+ * as bz2, are rejected now rather than when the first file is written.
+ *
+ * @param text The setting as typed; a bare level leaves the codec empty.
+ * @return arrow::Result<CompressionSpec> The codec and level, checked against Parquet and the Arrow build.
+ */
+arrow::Result<CompressionSpec> parse_compression(const std::string& text) {
+    ARROW_ASSIGN_OR_RAISE(CompressionSpec spec, split_compression(text));
+    if (spec.codec.empty()) return spec;
+    if (spec.codec == "lz4") spec.codec = "lz4_raw";
+
+    ARROW_ASSIGN_OR_RAISE(const auto type, arrow::util::Codec::GetCompressionType(spec.codec));
+    if (!parquet::IsCodecSupported(type)) return arrow::Status::Invalid("Parquet does not support the ", spec.codec, " codec");
+    ARROW_RETURN_NOT_OK(check_compression(spec, type));
+    return spec;
+}
+
+/**
+ * @brief Parses an output format such as "parquet", "arrow" or "arrow:lz4".
+ *
+ * Arrow IPC files only compress their buffers with LZ4 frames or ZSTD, and
+ * are left uncompressed unless a codec is given.
+ *
+ * @param text The format as typed.
+ * @param options Receives the format and the codec of Arrow output.
+ * @return arrow::Status OK, or Invalid for an unknown format or codec.
+ */
+arrow::Status parse_output_format(const std::string& text, ConvertOptions& options) {
+    const size_t colon = text.find(':');
+    const std::string format = text.substr(0, colon);
+    if (format == "parquet" && colon == std::string::npos) {
+        options.format = OutputFormat::kParquet;
+        return arrow::Status::OK();
+    }
+    if (format != "arrow") return arrow::Status::Invalid("unknown output format: ", text, " (expected parquet or arrow)");
+
+    CompressionSpec codec{"uncompressed", std::nullopt};
+    if (colon != std::string::npos) {
+        ARROW_ASSIGN_OR_RAISE(codec, split_compression(text.substr(colon + 1)));
+        if (codec.codec != "lz4" && codec.codec != "zstd" && codec.codec != "uncompressed")
+            return arrow::Status::Invalid("Arrow IPC files compress with lz4 or zstd, not ", text.substr(colon + 1));
+        ARROW_ASSIGN_OR_RAISE(const auto type, arrow::util::Codec::GetCompressionType(codec.codec));
+        ARROW_RETURN_NOT_OK(check_compression(codec, type));
+    }
+    options.format = OutputFormat::kArrow;
+    options.ipc_compression = codec;
+    return arrow::Status::OK();
+}
+
+/*! A codec and level resolved for one column. */
+struct ColumnCompression {
+    arrow::Compression::type codec = arrow::Compression::ZSTD;
+    std::optional<int> level;
+
+    bool operator==(const ColumnCompression& other) const { return codec == other.codec && level == other.level; }
+
+    /*! the setting as written to the key-value metadata, e.g. "zstd:19" */
+    std::string to_string() const {
+        std::string text = arrow::util::Codec::GetCodecAsString(codec);
+        if (level) text += ":" + std::to_string(*level);
+        return text;
+    }
+};
+
+/**
+ * @brief Resolves a compression setting, taking the codec from `inherited` when it names none.
+ */
+static arrow::Result<ColumnCompression> resolve_compression(const CompressionSpec& spec, const ColumnCompression& inherited) {
+    ColumnCompression resolved;
+    if (spec.codec.empty()) {
+        resolved.codec = inherited.codec;
+    } else {
+        ARROW_ASSIGN_OR_RAISE(resolved.codec, arrow::util::Codec::GetCompressionType(spec.codec));
+    }
+    resolved.level = spec.level;
+    if (resolved.level) {
+        // A bare level could not be checked against its codec when parsed
+        ARROW_ASSIGN_OR_RAISE(const int minimum, arrow::util::Codec::MinimumCompressionLevel(resolved.codec));
+        ARROW_ASSIGN_OR_RAISE(const int maximum, arrow::util::Codec::MaximumCompressionLevel(resolved.codec));
+        if (*resolved.level < minimum || *resolved.level > maximum)
+            return arrow::Status::Invalid(arrow::util::Codec::GetCodecAsString(resolved.codec), " level must be between ",
+                                          minimum, " and ", maximum);
+    }
+    return resolved;
+}
+
+/**
+ * @brief Resolves the codec and level of every column of the output.
+ *
+ * @param schema The Arrow schema of the output.
+ * @param options Conversion options (--compression, --column-compression).
+ * @return arrow::Result<std::vector<ColumnCompression>> The file-wide setting, followed by one per column.
+ */
+static arrow::Result<std::vector<ColumnCompression>> resolve_column_compression(const arrow::Schema& schema,
+                                                                                const ConvertOptions& options) {
+    std::vector<ColumnCompression> resolved;
+    ARROW_ASSIGN_OR_RAISE(const auto file, resolve_compression(options.compression, ColumnCompression{}));
+    resolved.push_back(file);
+    for (const auto& field : schema.fields()) {
+        const auto it = options.column_compression.find(field->name());
+        if (it == options.column_compression.end()) {
+            resolved.push_back(file);
+        } else {
+            ARROW_ASSIGN_OR_RAISE(const auto column, resolve_compression(it->second, file));
+            resolved.push_back(column);
+        }
+    }
+    return resolved;
+}
+
+/**
+ * @brief Sets the codecs and levels of the writer, and returns them as key-value metadata.
+ *
+ * @param schema The Arrow schema of the output.
+ * @param compression The file-wide setting followed by one per column.
+ * @param builder The writer properties to configure.
+ * @return std::shared_ptr<arrow::KeyValueMetadata> The settings, recorded in the file.
+ */
+static std::shared_ptr<arrow::KeyValueMetadata> configure_compression(const arrow::Schema& schema,
+                                                                      const std::vector<ColumnCompression>& compression,
+                                                                      parquet::WriterProperties::Builder& builder) {
+    const ColumnCompression& file = compression[0];
+    builder.compression(file.codec);
+    if (file.level) builder.compression_level(*file.level);
+
+    auto metadata = arrow::key_value_metadata({"dbc2parquet.compression"}, {file.to_string()});
+    std::string columns;
+    for (int col = 0; col < schema.num_fields(); col++) {
+        const ColumnCompression& column = compression[col + 1];
+        if (column == file) continue;
+        const std::string& name = schema.field(col)->name();
+        builder.compression(name, column.codec);
+        builder.compression_level(name, column.level ? *column.level : arrow::util::kUseDefaultCompressionLevel);
+        columns += (columns.empty() ? "" : ",") + name + "=" + column.to_string();
+    }
+    if (!columns.empty()) metadata->Append("dbc2parquet.column_compression", columns);
+    return metadata;
+}
+
+/*! compression ratio assumed for the first row group sized by bytes, before one has been measured */
+static constexpr double kAssumedCompressionRatio = 4.0;
+/*! bounds on the length of row groups sized by bytes */
+static constexpr int64_t kMinRowGroupRows = 1024;
+static constexpr int64_t kMaxRowGroupRows = 64 * 1024 * 1024;
+
+/**
+ * @brief Sets the page sizes and row group length of the writer from the options.
+ *
+ * With a row group byte target and no explicit page sizes, each column's
+ * share of the row group sets the data page size (an eighth of it, between
+ * 64 KiB and 1 MiB, so wide tables still get several pages per column chunk)
+ * and the dictionary limit (a sixteenth, between 1 and 8 MiB, so long row
+ * groups do not fall back to plain encoding early). The first row group
+ * length is estimated from the record length; later ones are corrected from
+ * the measured size of the previous one (see RowGroupCutter).
+ *
+ * Content-defined chunking ends data pages where a rolling hash of the
+ * values says so, rather than at a byte count, so a row inserted or removed
+ * only changes the pages around it and the rest stay byte-identical between
+ * versions of a file. Pages still never exceed the data page size.
+ *
+ * @param dbf The DBF file structure.
+ * @param columns Number of output columns.
+ * @param options Conversion options.
+ * @param builder The writer properties to configure.
+ * @return int64_t Rows of the first row group, or 0 to leave row groups to the writer.
+ */
+static int64_t configure_row_groups(const DBF& dbf, const int columns, const ConvertOptions& options,
+                                    parquet::WriterProperties::Builder& builder) {
+    int64_t page_size = options.page_size;
+    int64_t dictionary_limit = options.dictionary_page_limit;
+    int64_t first_rows = options.row_group_rows;
+
+    if (options.row_group_bytes > 0) {
+        const int64_t column_share = options.row_group_bytes / std::max(columns, 1);
+        if (page_size <= 0) page_size = std::clamp<int64_t>(column_share / 8, 64 << 10, 1 << 20);
+        if (dictionary_limit <= 0) dictionary_limit = std::clamp<int64_t>(column_share / 16, 1 << 20, 8 << 20);
+
+        const double row_bytes = std::max(1.0, dbf.header->record_length / kAssumedCompressionRatio);
+        const auto rows = std::clamp(static_cast<int64_t>(options.row_group_bytes / row_bytes), kMinRowGroupRows, kMaxRowGroupRows);
+        first_rows = first_rows > 0 ? std::min(first_rows, rows) : rows;
+        builder.max_row_group_length(options.row_group_rows > 0 ? options.row_group_rows : kMaxRowGroupRows);
+    } else if (options.row_group_rows > 0) {
+        builder.max_row_group_length(options.row_group_rows);
+    }
+
+    if (page_size > 0) builder.data_pagesize(page_size);
+    if (dictionary_limit > 0) builder.dictionary_pagesize_limit(dictionary_limit);
+
+    if (options.content_defined_chunking) {
+        parquet::CdcOptions cdc;
+        if (options.cdc_min_chunk_size > 0) cdc.min_chunk_size = options.cdc_min_chunk_size;
+        if (options.cdc_max_chunk_size > 0) cdc.max_chunk_size = options.cdc_max_chunk_size;
+        cdc.norm_level = options.cdc_norm_level;
+        builder.enable_content_defined_chunking()->content_defined_chunking_options(cdc);
+    }
+    return first_rows;
+}
+
+/*! rows sampled to choose the encodings of a file, in evenly spaced runs */
+static constexpr int64_t kEncodingSampleRows = 16384;
+static constexpr int64_t kEncodingSampleRuns = 8;
+/*! an encoding within this factor of the smallest one counts as small enough */
+static constexpr double kEncodingSizeTolerance = 1.05;
+
+/*! \struct EncodingCandidate
+	\brief One way of encoding a column, tried on a sample by --adaptive-encoding
+*/
+struct EncodingCandidate {
+    /*! dictionary encoding, falling back to `encoding` if the dictionary grows too large */
+    bool dictionary;
+    parquet::Encoding::type encoding;
+    /*! relative decoding cost, lowest first: plain, byte stream split, dictionary, delta, delta strings */
+    int decode_cost;
+};
+
+/**
+ * @brief Lists the encodings worth trying for an Arrow type.
+ *
+ * @return std::vector<EncodingCandidate> The candidates, or none to keep the writer default.
+ */
+static std::vector<EncodingCandidate> encoding_candidates(const arrow::DataType& type) {
+    using parquet::Encoding;
+    switch (type.id()) {
+        case arrow::Type::INT32:
+        case arrow::Type::INT64:
+        case arrow::Type::DATE32:
+        case arrow::Type::TIMESTAMP:
+            return {{false, Encoding::PLAIN, 0}, {true, Encoding::PLAIN, 2}, {false, Encoding::DELTA_BINARY_PACKED, 3}};
+        case arrow::Type::DOUBLE:
+            return {{false, Encoding::PLAIN, 0}, {false, Encoding::BYTE_STREAM_SPLIT, 1}, {true, Encoding::PLAIN, 2}};
+        case arrow::Type::STRING:
+            return {{false, Encoding::PLAIN, 0}, {true, Encoding::PLAIN, 2}, {false, Encoding::DELTA_BYTE_ARRAY, 4}};
+        default:
+            return {};
+    }
+}
+
+/**
+ * @brief Decodes evenly spaced runs of rows, in output order, to try encodings on.
+ */
+static arrow::Result<std::shared_ptr<arrow::Table>> sample_rows(const DBF& dbf, const OutputRows& out, const std::vector<ColumnSpec>& specs,
+                                                                arrow::MemoryPool* pool) {
+    const int64_t records = out.num_rows;
+    const int64_t run = kEncodingSampleRows / kEncodingSampleRuns;
+    ARROW_ASSIGN_OR_RAISE(auto ctx, make_batch_context(dbf, out.schema, specs, static_cast<int>(run), pool, out.columns));
+
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    if (records <= kEncodingSampleRows) {
+        for (int64_t start = 0; start < records; start += run) {
+            ARROW_ASSIGN_OR_RAISE(auto batch, create_arrow_batch(dbf, out.schema, *ctx, start, std::min(run, records - start), out.rows));
+            batches.push_back(std::move(batch));
+        }
+    } else {
+        for (int64_t i = 0; i < kEncodingSampleRuns; i++) {
+            const int64_t start = i * (records - run) / (kEncodingSampleRuns - 1);
+            ARROW_ASSIGN_OR_RAISE(auto batch, create_arrow_batch(dbf, out.schema, *ctx, start, run, out.rows));
+            batches.push_back(std::move(batch));
+        }
+    }
+    return arrow::Table::FromRecordBatches(out.schema, batches);
+}
+
+/**
+ * @brief Writes one column with one encoding to memory and returns the file size.
+ */
+static arrow::Result<int64_t> trial_encoded_size(const std::shared_ptr<arrow::Field>& field, const std::shared_ptr<arrow::ChunkedArray>& column,
+                                                 const EncodingCandidate& candidate, const ColumnCompression& compression,
+                                                 arrow::MemoryPool* pool) {
+    parquet::WriterProperties::Builder builder;
+    builder.compression(compression.codec);
+    if (compression.level) builder.compression_level(*compression.level);
+    builder.memory_pool(pool);
+    if (candidate.dictionary) builder.enable_dictionary();
+    else builder.disable_dictionary();
+    builder.encoding(candidate.encoding);
+
+    const auto table = arrow::Table::Make(arrow::schema({field}), {column});
+    ARROW_ASSIGN_OR_RAISE(auto sink, arrow::io::BufferOutputStream::Create(64 * 1024, pool));
+    ARROW_RETURN_NOT_OK(parquet::arrow::WriteTable(*table, pool, sink, std::max<int64_t>(column->length(), 1), builder.build()));
+    ARROW_ASSIGN_OR_RAISE(auto buffer, sink->Finish());
+    return buffer->size();
+}
+
+/**
+ * @brief Picks the encoding of each column by trying the candidates on a sample.
+ *
+ * Each candidate writes the sampled column, compressed as the real output
+ * is. Among those within kEncodingSizeTolerance of the smallest, the one
+ * cheapest to decode wins. Decoding cost is a fixed ranking rather than a
+ * measurement, so the same input always gets the same encodings. A column
+ * left on dictionary encoding falls back to the best plain-side candidate
+ * if its dictionary overflows.
+ *
+ * @param dbf The DBF file structure.
+ * @param out The columns and rows of the output.
+ * @param specs The decoding plan of every column.
+ * @param compression The file-wide codec followed by the codec of each column.
+ * @param pool Memory pool for the sample and the trial writes.
+ * @param builder The writer properties that receive the choices.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status choose_column_encodings(const DBF& dbf, const OutputRows& out, const std::vector<ColumnSpec>& specs,
+                                             const std::vector<ColumnCompression>& compression, arrow::MemoryPool* pool,
+                                             parquet::WriterProperties::Builder& builder) {
+    if (out.num_rows == 0) return arrow::Status::OK();
+    const auto& schema = out.schema;
+    ARROW_ASSIGN_OR_RAISE(const auto sample, sample_rows(dbf, out, specs, pool));
+
+    const int columns = schema->num_fields();
+    std::vector<std::optional<EncodingCandidate>> chosen(columns);
+    std::vector<std::optional<EncodingCandidate>> fallback(columns);
+
+    auto choose = [&](const int col) -> arrow::Status {
+        const auto candidates = encoding_candidates(*schema->field(col)->type());
+        if (candidates.empty()) return arrow::Status::OK();
+
+        std::vector<int64_t> sizes;
+        for (const auto& candidate : candidates) {
+            ARROW_ASSIGN_OR_RAISE(const int64_t size, trial_encoded_size(schema->field(col), sample->column(col), candidate, compression[col + 1], pool));
+            sizes.push_back(size);
+        }
+        const double limit = static_cast<double>(*std::min_element(sizes.begin(), sizes.end())) * kEncodingSizeTolerance;
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (static_cast<double>(sizes[i]) > limit) continue;
+            if (!chosen[col] || candidates[i].decode_cost < chosen[col]->decode_cost) chosen[col] = candidates[i];
+        }
+        size_t smallest_plain = candidates.size();
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (!candidates[i].dictionary && (smallest_plain == candidates.size() || sizes[i] < sizes[smallest_plain])) smallest_plain = i;
+        }
+        if (smallest_plain < candidates.size()) fallback[col] = candidates[smallest_plain];
+        return arrow::Status::OK();
+    };
+    if (columns > 1 && arrow::GetCpuThreadPoolCapacity() > 1) {
+        ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(columns, choose));
+    } else {
+        for (int col = 0; col < columns; col++) ARROW_RETURN_NOT_OK(choose(col));
+    }
+
+    for (int col = 0; col < columns; col++) {
+        if (!chosen[col]) continue;
+        const auto path = std::make_shared<parquet::schema::ColumnPath>(std::vector<std::string>{schema->field(col)->name()});
+        if (chosen[col]->dictionary) {
+            builder.enable_dictionary(path);
+            if (fallback[col]) builder.encoding(path, fallback[col]->encoding);
+        } else {
+            builder.disable_dictionary(path);
+            builder.encoding(path, chosen[col]->encoding);
+        }
+    }
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Parses a list of sort keys such as "MUNIC_RES,DT_INTER:desc".
+ *
+ * @param text Comma-separated column names, each optionally followed by ":asc" or ":desc".
+ * @return arrow::Result<std::vector<SortKey>> The keys, in order.
+ */
+arrow::Result<std::vector<SortKey>> parse_sort_keys(const std::string& text) {
+    std::vector<SortKey> keys;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string item = text.substr(start, end - start);
+        start = end + 1;
+
+        SortKey key;
+        const size_t colon = item.rfind(':');
+        if (colon != std::string::npos) {
+            std::string direction = item.substr(colon + 1);
+            for (auto& c : direction) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (direction == "desc") key.descending = true;
+            else if (direction != "asc") return arrow::Status::Invalid("sort direction must be asc or desc: ", item);
+            item.resize(colon);
+        }
+        if (item.empty()) return arrow::Status::Invalid("empty column name in sort order: ", text);
+        key.column = item;
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+/**
+ * @brief Counts the distinct raw values of a column among the rows of an output, up to a limit.
+ *
+ * Sizes bloom filters: the count over the rows of the file bounds the count
+ * of each of its row groups, and a partition is sized for its own rows.
+ */
+static int64_t count_distinct_values(const DBF& dbf, const OutputRows& out, const int col, const int64_t limit) {
+    const size_t record_length = dbf.header->record_length;
+    const size_t field_length = dbf.fields[col].field_length;
+    const char* field_data = reinterpret_cast<const char*>(dbf.mem_buffer.data() + dbf.header->header_length + dbf.fields[col].field_offset);
+
+    std::unordered_set<std::string_view> distinct;
+    for (int64_t i = 0; i < out.num_rows && static_cast<int64_t>(distinct.size()) < limit; i++) {
+        const size_t row = out.rows ? out.rows[i] : static_cast<size_t>(i);
+        distinct.insert(trim_view(field_data + row * record_length, field_length));
+    }
+    return static_cast<int64_t>(distinct.size());
+}
+
+/**
+ * @brief Sets the bloom filters, page index and sorting columns of the writer.
+ *
+ * @param dbf The DBF file structure.
+ * @param out The columns and rows of the output.
+ * @param options Conversion options.
+ * @param builder The writer properties to configure.
+ * @return std::vector<parquet::SortingColumn> The declared order, to check while writing.
+ */
+static std::vector<parquet::SortingColumn> configure_indexes(const DBF& dbf, const OutputRows& out, const ConvertOptions& options,
+                                                             parquet::WriterProperties::Builder& builder) {
+    const arrow::Schema& schema = *out.schema;
+    int64_t row_group_rows = parquet::DEFAULT_MAX_ROW_GROUP_LENGTH;
+    if (options.row_group_rows > 0) row_group_rows = options.row_group_rows;
+    else if (options.row_group_bytes > 0) row_group_rows = kMaxRowGroupRows;
+
+    for (const auto& name : options.bloom_filter_columns) {
+        const int col = schema.GetFieldIndex(name);
+        // Parquet bloom filters do not cover booleans
+        if (col < 0 || schema.field(col)->type()->id() == arrow::Type::BOOL) continue;
+
+        parquet::BloomFilterOptions bloom;
+        bloom.fpp = options.bloom_filter_fpp;
+        const int64_t ndv = options.bloom_filter_ndv > 0 ? options.bloom_filter_ndv : count_distinct_values(dbf, out, out.columns[col], row_group_rows);
+        bloom.ndv = static_cast<int32_t>(std::clamp<int64_t>(ndv, 1, std::numeric_limits<int32_t>::max()));
+        builder.enable_bloom_filter(name, bloom);
+    }
+
+    for (const auto& name : options.page_index_columns) {
+        if (name == "*") builder.enable_write_page_index();
+        else if (schema.GetFieldIndex(name) >= 0) builder.enable_write_page_index(name);
+    }
+
+    // Rows sorted by --sort-by follow that order, whatever else was declared
+    std::vector<parquet::SortingColumn> sorting;
+    for (const auto& key : options.sort_by.empty() ? options.sorting_columns : options.sort_by) {
+        const int col = schema.GetFieldIndex(key.column);
+        // A partition column is constant within the file and does not break the prefix
+        if (col < 0 && std::count(options.partition_by.begin(), options.partition_by.end(), key.column) > 0) continue;
+        if (col < 0) break;  // the order is only meaningful as a prefix
+        // Nulls first when ascending and last when descending, as Spark does
+        sorting.push_back(parquet::SortingColumn{col, key.descending, !key.descending});
+    }
+    if (!sorting.empty()) builder.set_sorting_columns(sorting);
+    return sorting;
+}
+
+/**
+ * @brief Reads a string or dictionary-encoded string value.
+ */
+static std::string_view string_value(const arrow::Array& array, const int64_t i) {
+    if (array.type_id() == arrow::Type::DICTIONARY) {
+        const auto& dictionary = static_cast<const arrow::DictionaryArray&>(array);
+        const auto index = static_cast<const arrow::Int32Array&>(*dictionary.indices()).Value(i);
+        return static_cast<const arrow::StringArray&>(*dictionary.dictionary()).GetView(index);
+    }
+    return static_cast<const arrow::StringArray&>(array).GetView(i);
+}
+
+template <typename T>
+static int three_way(const T& a, const T& b) {
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+/**
+ * @brief Compares two non-null values of the same column, possibly from different batches.
+ *
+ * @return int Negative, zero or positive, as for strcmp.
+ */
+static int compare_values(const arrow::Array& a, const int64_t i, const arrow::Array& b, const int64_t j) {
+    switch (a.type_id()) {
+        case arrow::Type::INT32:
+            return three_way(static_cast<const arrow::Int32Array&>(a).Value(i), static_cast<const arrow::Int32Array&>(b).Value(j));
+        case arrow::Type::INT64:
+            return three_way(static_cast<const arrow::Int64Array&>(a).Value(i), static_cast<const arrow::Int64Array&>(b).Value(j));
+        case arrow::Type::DATE32:
+            return three_way(static_cast<const arrow::Date32Array&>(a).Value(i), static_cast<const arrow::Date32Array&>(b).Value(j));
+        case arrow::Type::TIMESTAMP:
+            return three_way(static_cast<const arrow::TimestampArray&>(a).Value(i), static_cast<const arrow::TimestampArray&>(b).Value(j));
+        case arrow::Type::DOUBLE:
+            return three_way(static_cast<const arrow::DoubleArray&>(a).Value(i), static_cast<const arrow::DoubleArray&>(b).Value(j));
+        case arrow::Type::BOOL:
+            return three_way(static_cast<const arrow::BooleanArray&>(a).Value(i), static_cast<const arrow::BooleanArray&>(b).Value(j));
+        case arrow::Type::DECIMAL128:
+            return three_way(arrow::Decimal128(static_cast<const arrow::Decimal128Array&>(a).GetValue(i)),
+                             arrow::Decimal128(static_cast<const arrow::Decimal128Array&>(b).GetValue(j)));
+        default:
+            return string_value(a, i).compare(string_value(b, j));
+    }
+}
+
+/**
+ * @brief Compares two rows by a sort order, placing nulls as the order says.
+ */
+static int compare_rows(const arrow::RecordBatch& a, const int64_t i, const arrow::RecordBatch& b, const int64_t j,
+                        const std::vector<parquet::SortingColumn>& order) {
+    for (const auto& key : order) {
+        const arrow::Array& x = *a.column(key.column_idx);
+        const arrow::Array& y = *b.column(key.column_idx);
+        const bool x_null = x.IsNull(i);
+        const bool y_null = y.IsNull(j);
+        int result;
+        if (x_null || y_null) {
+            result = x_null == y_null ? 0 : ((x_null == key.nulls_first) ? -1 : 1);
+        } else {
+            result = compare_values(x, i, y, j);
+            if (key.descending) result = -result;
+        }
+        if (result != 0) return result;
+    }
+    return 0;
+}
+
+/*! \class SortOrderCheck
+	\brief Verifies that the rows written follow the declared sorting columns
+
+	Engines skip row groups and pages on the strength of sorting_columns, so
+	a wrong declaration would make them return wrong results; a file whose
+	rows break the order fails instead.
+*/
+class SortOrderCheck {
+public:
+    SortOrderCheck(const arrow::Schema& schema, std::vector<parquet::SortingColumn> order)
+        : schema_(schema), order_(std::move(order)) {}
+
+    arrow::Status check(const arrow::RecordBatch& batch) {
+        if (order_.empty() || batch.num_rows() == 0) return arrow::Status::OK();
+        if (previous_ && compare_rows(*previous_, 0, batch, 0, order_) > 0) return unsorted(0);
+        for (int64_t row = 1; row < batch.num_rows(); row++) {
+            if (compare_rows(batch, row - 1, batch, row, order_) > 0) return unsorted(row);
+        }
+        rows_ += batch.num_rows();
+        previous_ = batch.Slice(batch.num_rows() - 1, 1);
+        return arrow::Status::OK();
+    }
+
+private:
+    arrow::Status unsorted(const int64_t row) const {
+        std::string columns;
+        for (const auto& key : order_) columns += (columns.empty() ? "" : ",") + schema_.field(key.column_idx)->name();
+        return arrow::Status::Invalid("rows are not sorted by ", columns, " at row ", rows_ + row);
+    }
+
+    const arrow::Schema& schema_;
+    const std::vector<parquet::SortingColumn> order_;
+    std::shared_ptr<arrow::RecordBatch> previous_;
+    int64_t rows_ = 0;
+};
+
+/*! rows of the smallest run an external sort spills */
+static constexpr int64_t kMinSortRunRows = 64 * 1024;
+/*! runs merged at once; larger files get longer runs rather than more of them */
+static constexpr int64_t kMaxSortRuns = 256;
+/*! bytes read ahead from each run while merging */
+static constexpr size_t kSortRunReadBytes = 256 * 1024;
+
+/*! \struct SortKeyLayout
+	\brief Where one --sort-by column sits in a normalized row key
+
+	Each column takes a null flag byte followed by `width` value bytes, laid
+	out so that comparing whole keys with memcmp() gives the row order:
+	integers are big-endian with the sign bit flipped, strings are padded
+	with zeros, and descending columns have every byte inverted.
+*/
+struct SortKeyLayout {
+    int column;
+    bool descending;
+    arrow::Type::type type;
+    /*! offset of the null flag in the key */
+    size_t offset;
+    /*! value bytes after the null flag */
+    size_t width;
+};
+
+/*! \struct BudgetCharge
+	\brief Counts a buffer allocated outside the Arrow pool against the memory budget
+*/
+struct BudgetCharge {
+    BudgetCharge(MemoryBudget* budget, const int64_t bytes) : budget(budget), bytes(bytes) {
+        if (budget) budget->add(bytes);
+    }
+    ~BudgetCharge() {
+        if (budget) budget->remove(bytes);
+    }
+    BudgetCharge(const BudgetCharge&) = delete;
+    BudgetCharge& operator=(const BudgetCharge&) = delete;
+
+    MemoryBudget* budget;
+    const int64_t bytes;
+};
+
+/*! \struct SortEntry
+	\brief A row and the first bytes of its key, compared before the full key
+*/
+struct SortEntry {
+    uint64_t prefix;
+    uint32_t row;
+};
+
+/**
+ * @brief Bounds the UTF-8 length of the values of a character column.
+ *
+ * Trimmed bytes below 0x80 stay one byte; any other byte of a single-byte
+ * code page becomes at most three, so no value needs to be converted.
+ */
+static size_t max_text_key_width(const DBF& dbf, const int col) {
+    const auto& field = dbf.fields[col];
+    const size_t record_length = dbf.header->record_length;
+    const unsigned char* record = dbf.mem_buffer.data() + dbf.header->header_length + field.field_offset;
+
+    size_t width = 0;
+    for (uint32_t row = 0; row < dbf.header->records; row++, record += record_length) {
+        const std::string_view text = trim_view(reinterpret_cast<const char*>(record), field.field_length);
+        if (text.size() * 3 <= width) continue;
+        size_t length = text.size();
+        for (const char c : text) {
+            if (static_cast<unsigned char>(c) >= 0x80) length += 2;
+        }
+        width = std::max(width, length);
+    }
+    return width;
+}
+
+/**
+ * @brief Lays out the normalized key of the --sort-by columns.
+ *
+ * @param key_width Set to the bytes of one row key.
+ * @return std::vector<SortKeyLayout> One entry per sort column.
+ */
+static arrow::Result<std::vector<SortKeyLayout>> plan_sort_keys(const DBF& dbf, const arrow::Schema& schema, const std::vector<SortKey>& keys,
+                                                                size_t& key_width) {
+    std::vector<SortKeyLayout> layouts;
+    key_width = 0;
+    for (const auto& key : keys) {
+        const int col = schema.GetFieldIndex(key.column);
+        if (col < 0) return arrow::Status::Invalid("--sort-by: no column ", key.column);
+
+        SortKeyLayout layout{col, key.descending, schema.field(col)->type()->id(), key_width, 0};
+        switch (layout.type) {
+            case arrow::Type::BOOL: layout.width = 1; break;
+            case arrow::Type::INT32: case arrow::Type::DATE32: layout.width = 4; break;
+            case arrow::Type::INT64: case arrow::Type::TIMESTAMP: case arrow::Type::DOUBLE: layout.width = 8; break;
+            case arrow::Type::DECIMAL128: layout.width = 16; break;
+            case arrow::Type::STRING: case arrow::Type::DICTIONARY:
+                if (!is_binary_field(dbf.fields[col])) {
+                    layout.width = max_text_key_width(dbf, col);
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                return arrow::Status::NotImplemented("--sort-by: cannot sort by ", key.column, " (", schema.field(col)->type()->ToString(), ")");
+        }
+        key_width += 1 + layout.width;
+        layouts.push_back(layout);
+    }
+    return layouts;
+}
+
+static void store_big_endian(uint64_t value, unsigned char* out, const int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        out[i] = static_cast<unsigned char>(value);
+        value >>= 8;
+    }
+}
+
+/**
+ * @brief Writes the part of a row key that holds one decoded value.
+ *
+ * Nulls sort first when ascending and last when descending, as declared
+ * in the sorting_columns of the output.
+ */
+static void encode_sort_key(const arrow::Array& array, const int64_t i, const SortKeyLayout& layout, unsigned char* key) {
+    unsigned char* out = key + layout.offset;
+    std::memset(out, 0, 1 + layout.width);
+    if (array.IsValid(i)) {
+        out[0] = 1;
+        unsigned char* value = out + 1;
+        switch (layout.type) {
+            case arrow::Type::BOOL:
+                value[0] = static_cast<const arrow::BooleanArray&>(array).Value(i) ? 1 : 0;
+                break;
+            case arrow::Type::INT32: case arrow::Type::DATE32:
+                store_big_endian(static_cast<uint32_t>(array.data()->GetValues<int32_t>(1)[i]) ^ 0x80000000u, value, 4);
+                break;
+            case arrow::Type::INT64: case arrow::Type::TIMESTAMP:
+                store_big_endian(static_cast<uint64_t>(array.data()->GetValues<int64_t>(1)[i]) ^ (uint64_t{1} << 63), value, 8);
+                break;
+            case arrow::Type::DOUBLE: {
+                uint64_t bits;
+                std::memcpy(&bits, array.data()->GetValues<double>(1) + i, sizeof(bits));
+                // Negative numbers order by inverted magnitude, positive ones after all of them
+                bits = (bits >> 63) ? ~bits : bits | (uint64_t{1} << 63);
+                store_big_endian(bits, value, 8);
+                break;
+            }
+            case arrow::Type::DECIMAL128: {
+                const arrow::Decimal128 decimal(static_cast<const arrow::Decimal128Array&>(array).GetValue(i));
+                store_big_endian(static_cast<uint64_t>(decimal.high_bits()) ^ (uint64_t{1} << 63), value, 8);
+                store_big_endian(decimal.low_bits(), value + 8, 8);
+                break;
+            }
+            default: {
+                const std::string_view text = string_value(array, i);
+                std::memcpy(value, text.data(), std::min(text.size(), layout.width));
+                break;
+            }
+        }
+    }
+    if (layout.descending) {
+        for (size_t b = 0; b <= layout.width; b++) out[b] = static_cast<unsigned char>(~out[b]);
+    }
+}
+
+/**
+ * @brief Sorts the rows of one run by their keys; ties keep the file order.
+ *
+ * Large runs are sorted in chunks on the CPU pool and merged.
+ *
+ * @param keys Row keys of the run, `key_width` bytes each, starting at row `first_row`.
+ * @return std::vector<uint32_t> The row numbers in order.
+ */
+static arrow::Result<std::vector<uint32_t>> sort_run(const unsigned char* keys, const size_t key_width, const uint32_t first_row,
+                                                     const int64_t rows) {
+    std::vector<SortEntry> entries(static_cast<size_t>(rows));
+    for (int64_t i = 0; i < rows; i++) {
+        uint64_t prefix = 0;
+        for (size_t b = 0; b < 8; b++) prefix = (prefix << 8) | (b < key_width ? keys[i * key_width + b] : 0);
+        entries[i] = SortEntry{prefix, first_row + static_cast<uint32_t>(i)};
+    }
+
+    auto less = [&](const SortEntry& a, const SortEntry& b) {
+        if (a.prefix != b.prefix) return a.prefix < b.prefix;
+        if (key_width > 8) {
+            const int c = std::memcmp(keys + (a.row - first_row) * key_width + 8, keys + (b.row - first_row) * key_width + 8, key_width - 8);
+            if (c != 0) return c < 0;
+        }
+        return a.row < b.row;
+    };
+
+    const int chunks = static_cast<int>(std::clamp<int64_t>(rows / kMinSortRunRows, 1, arrow::GetCpuThreadPoolCapacity()));
+    if (chunks > 1) {
+        std::vector<int64_t> bounds(chunks + 1);
+        for (int c = 0; c <= chunks; c++) bounds[c] = rows * c / chunks;
+        ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(chunks, [&](const int c) {
+            std::sort(entries.begin() + bounds[c], entries.begin() + bounds[c + 1], less);
+            return arrow::Status::OK();
+        }));
+        for (int step = 1; step < chunks; step *= 2) {
+            for (int c = 0; c + step < chunks; c += 2 * step) {
+                std::inplace_merge(entries.begin() + bounds[c], entries.begin() + bounds[c + step],
+                                   entries.begin() + bounds[std::min(c + 2 * step, chunks)], less);
+            }
+        }
+    } else {
+        std::sort(entries.begin(), entries.end(), less);
+    }
+
+    std::vector<uint32_t> order(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) order[i] = entries[i].row;
+    return order;
+}
+
+/*! \class SpillFile
+	\brief Temporary file holding one sorted run, removed when destroyed
+*/
+class SpillFile {
+public:
+    static arrow::Result<std::unique_ptr<SpillFile>> create(const std::string& path) {
+        FILE* file = std::fopen(path.c_str(), "w+b");
+        if (!file) return arrow::Status::IOError("Cannot create sort spill file ", path, ": ", std::strerror(errno));
+        return std::unique_ptr<SpillFile>(new SpillFile(path, file));
+    }
+    ~SpillFile() {
+        std::fclose(file_);
+        std::remove(path_.c_str());
+    }
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    FILE* file() const { return file_; }
+    const std::string& path() const { return path_; }
+
+private:
+    SpillFile(std::string path, FILE* file) : path_(std::move(path)), file_(file) {}
+
+    std::string path_;
+    FILE* file_;
+};
+
+/*! \struct RunCursor
+	\brief Reads the entries of a spilled run (key, then row number) in order
+*/
+struct RunCursor {
+    SpillFile* run;
+    size_t entry_bytes;
+    int64_t remaining;
+    std::vector<unsigned char> buffer;
+    size_t position = 0;
+    size_t end = 0;
+
+    const unsigned char* key() const { return buffer.data() + position; }
+    uint32_t row() const {
+        uint32_t row;
+        std::memcpy(&row, buffer.data() + position + entry_bytes - sizeof(row), sizeof(row));
+        return row;
+    }
+
+    /**
+     * @brief Moves to the next entry, reading ahead when the buffer is used up.
+     *
+     * @return bool false once the run is exhausted.
+     */
+    arrow::Result<bool> advance() {
+        position += entry_bytes;
+        if (position < end) return true;
+        if (remaining == 0) return false;
+
+        const int64_t count = std::min<int64_t>(remaining, std::max<size_t>(1, kSortRunReadBytes / entry_bytes));
+        buffer.resize(static_cast<size_t>(count) * entry_bytes);
+        if (std::fread(buffer.data(), entry_bytes, static_cast<size_t>(count), run->file()) != static_cast<size_t>(count)) {
+            return arrow::Status::IOError("Cannot read sort spill file ", run->path());
+        }
+        remaining -= count;
+        position = 0;
+        end = buffer.size();
+        return true;
+    }
+};
+
+/**
+ * @brief Writes a sorted run to a spill file, one key and row number per row.
+ */
+static arrow::Status spill_run(SpillFile& run, const std::vector<uint32_t>& order, const unsigned char* keys, const size_t key_width,
+                               const uint32_t first_row) {
+    const size_t entry_bytes = key_width + sizeof(uint32_t);
+    std::vector<unsigned char> buffer;
+    buffer.reserve(std::max(kSortRunReadBytes, entry_bytes));
+    for (size_t i = 0; i < order.size(); i++) {
+        const unsigned char* key = keys + static_cast<size_t>(order[i] - first_row) * key_width;
+        buffer.insert(buffer.end(), key, key + key_width);
+        const auto* row = reinterpret_cast<const unsigned char*>(&order[i]);
+        buffer.insert(buffer.end(), row, row + sizeof(uint32_t));
+        if (buffer.size() + entry_bytes > buffer.capacity() || i + 1 == order.size()) {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), run.file()) != buffer.size()) {
+                return arrow::Status::IOError("Cannot write sort spill file ", run.path());
+            }
+            buffer.clear();
+        }
+    }
+    if (std::fflush(run.file()) != 0 || std::fseek(run.file(), 0, SEEK_SET) != 0) {
+        return arrow::Status::IOError("Cannot write sort spill file ", run.path());
+    }
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Merges spilled runs into the final row order.
+ *
+ * The read buffer of each run is charged to the budget while merging.
+ */
+static arrow::Status merge_runs(const std::vector<std::unique_ptr<SpillFile>>& runs, const std::vector<int64_t>& run_rows,
+                                const size_t key_width, std::vector<uint32_t>& order, MemoryBudget* budget) {
+    const size_t entry_bytes = key_width + sizeof(uint32_t);
+    const BudgetCharge buffers(budget, static_cast<int64_t>(runs.size() * std::max(kSortRunReadBytes, entry_bytes)));
+    std::vector<RunCursor> cursors;
+    for (size_t r = 0; r < runs.size(); r++) {
+        cursors.push_back(RunCursor{runs[r].get(), entry_bytes, run_rows[r], {}});
+        // Start "past the end" of an empty buffer so the first advance() reads
+        cursors.back().position = cursors.back().entry_bytes;
+    }
+
+    // Min-heap of cursors by key, ties by row number as in sort_run()
+    auto greater = [&](const size_t a, const size_t b) {
+        const int c = std::memcmp(cursors[a].key(), cursors[b].key(), key_width);
+        if (c != 0) return c > 0;
+        return cursors[a].row() > cursors[b].row();
+    };
+    std::vector<size_t> heap;
+    for (size_t r = 0; r < cursors.size(); r++) {
+        ARROW_ASSIGN_OR_RAISE(const bool valid, cursors[r].advance());
+        if (valid) heap.push_back(r);
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        RunCursor& cursor = cursors[heap.back()];
+        order.push_back(cursor.row());
+        ARROW_ASSIGN_OR_RAISE(const bool valid, cursor.advance());
+        if (valid) std::push_heap(heap.begin(), heap.end(), greater);
+        else heap.pop_back();
+    }
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Orders the rows of a DBF by the --sort-by columns.
+ *
+ * Only the key columns are decoded, a batch at a time, into normalized row
+ * keys. When the keys and sort entries of the whole file do not fit in what
+ * is left of the memory budget, the file is sorted in runs that do, each
+ * spilled next to the output, and the runs are merged from disk. Either way
+ * the result is the same: ties keep the order of the file. The keys, the
+ * sort entries and the merge buffers are charged to the budget while they
+ * are held; the caller charges the returned order for as long as it keeps it.
+ *
+ * @param dbf The DBF file structure.
+ * @param schema The Arrow schema of the output.
+ * @param specs The decoding plan of every column.
+ * @param options Conversion options (sort keys, batch size, memory budget).
+ * @param pool Memory pool for the key columns.
+ * @param spill_prefix Path the spill files are named after.
+ * @return std::vector<uint32_t> Row numbers in output order.
+ */
+static arrow::Result<std::vector<uint32_t>> sort_rows(const DBF& dbf, const std::shared_ptr<arrow::Schema>& schema, const std::vector<ColumnSpec>& specs,
+                                                      const ConvertOptions& options, arrow::MemoryPool* pool, const std::string& spill_prefix) {
+    size_t key_width = 0;
+    ARROW_ASSIGN_OR_RAISE(const auto layouts, plan_sort_keys(dbf, *schema, options.sort_by, key_width));
+    const int64_t records = dbf.header->records;
+    if (records == 0) return std::vector<uint32_t>{};
+
+    MemoryBudget* budget = options.memory_budget.get();
+    const int64_t row_bytes = static_cast<int64_t>(key_width + sizeof(SortEntry) + sizeof(uint32_t));
+    int64_t run_rows = records;
+    if (budget && budget->limit() > 0 && records * row_bytes > budget->limit() - budget->used()) {
+        const int64_t fitting = std::max<int64_t>(budget->limit() - budget->used(), 0) / row_bytes;
+        run_rows = std::max({fitting, kMinSortRunRows, (records + kMaxSortRuns - 1) / kMaxSortRuns});
+    }
+
+    std::vector<int> key_columns;
+    arrow::FieldVector key_fields;
+    for (const auto& layout : layouts) {
+        key_columns.push_back(layout.column);
+        key_fields.push_back(schema->field(layout.column));
+    }
+    const auto key_schema = arrow::schema(key_fields);
+    ARROW_ASSIGN_OR_RAISE(auto ctx, make_batch_context(dbf, key_schema, specs, options.batch_size, pool, key_columns));
+
+    std::vector<uint32_t> order;
+    std::vector<std::unique_ptr<SpillFile>> runs;
+    std::vector<int64_t> run_lengths;
+    std::vector<unsigned char> keys;
+    for (int64_t run_start = 0; run_start < records; run_start += run_rows) {
+        const int64_t run_length = std::min(run_rows, records - run_start);
+        const BudgetCharge charge(budget, run_length * row_bytes);
+        keys.resize(static_cast<size_t>(run_length) * key_width);
+
+        for (int64_t start = run_start; start < run_start + run_length; start += options.batch_size) {
+            const int64_t rows = std::min<int64_t>(options.batch_size, run_start + run_length - start);
+            ARROW_ASSIGN_OR_RAISE(auto batch, create_arrow_batch(dbf, key_schema, *ctx, start, rows));
+            unsigned char* batch_keys = keys.data() + static_cast<size_t>(start - run_start) * key_width;
+            for (size_t k = 0; k < layouts.size(); k++) {
+                const arrow::Array& column = *batch->column(static_cast<int>(k));
+                for (int64_t i = 0; i < rows; i++) encode_sort_key(column, i, layouts[k], batch_keys + i * key_width);
+            }
+        }
+
+        ARROW_ASSIGN_OR_RAISE(auto sorted, sort_run(keys.data(), key_width, static_cast<uint32_t>(run_start), run_length));
+        if (run_length == records) return sorted;
+
+        ARROW_ASSIGN_OR_RAISE(auto run, SpillFile::create(spill_prefix + ".sort" + std::to_string(runs.size()) + ".tmp"));
+        runs.push_back(std::move(run));
+        run_lengths.push_back(run_length);
+        ARROW_RETURN_NOT_OK(spill_run(*runs.back(), sorted, keys.data(), key_width, static_cast<uint32_t>(run_start)));
+    }
+
+    std::vector<unsigned char>().swap(keys);
+    const BudgetCharge order_charge(budget, records * static_cast<int64_t>(sizeof(uint32_t)));
+    order.reserve(static_cast<size_t>(records));
+    ARROW_RETURN_NOT_OK(merge_runs(runs, run_lengths, key_width, order, budget));
+    return order;
+}
+
+/**
+ * @brief Path of one part of a split output: `name.parquet` becomes `name-00003.parquet`.
+ */
+std::string part_path(const std::string& path, const int index) {
+    std::filesystem::path part(path);
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "-%05d", index);
+    part.replace_filename(part.stem().string() + suffix + part.extension().string());
+    return part.string();
+}
+
+/*! \class OutputFiles
+	\brief The Parquet file being written, and the ones after it when the output is split
+
+	Unsplit output is the single file at the output path. Split output
+	(--max-file-bytes, --max-file-rows) is a series of parts named after it,
+	`name-00000.parquet` onwards; roll() closes the current part and opens the
+	next. Atomic files, which every part is, are written under a hidden
+	temporary name and renamed once closed, so readers never see a partial
+	file. If the output is not finished, the parts already written are
+	removed along with the partial one; once it is, whatever an earlier
+	conversion left in the other layout is removed instead: the parts
+	numbered after the last one, the unsplit file of split output and every
+	part of unsplit output. The footer of each file closed goes to the summary, if
+	any.
+*/
+class OutputFiles {
+public:
+    OutputFiles(std::string path, const bool split, const bool atomic, std::shared_ptr<arrow::Schema> schema, arrow::MemoryPool* pool,
+                std::shared_ptr<parquet::WriterProperties> properties, std::shared_ptr<parquet::ArrowWriterProperties> arrow_properties,
+                std::shared_ptr<const arrow::KeyValueMetadata> metadata, DatasetSummary* summary)
+        : path_(std::move(path)), split_(split), atomic_(atomic || split), schema_(std::move(schema)), pool_(pool),
+          properties_(std::move(properties)), arrow_properties_(std::move(arrow_properties)), metadata_(std::move(metadata)),
+          summary_(summary) {}
+
+    ~OutputFiles() {
+        if (finished_) return;
+        std::error_code ec;
+        if (sink_) (void)sink_->Close();
+        if (atomic_) std::filesystem::remove(temp_path(), ec);
+        for (const auto& part : written_) std::filesystem::remove(part, ec);
+    }
+    OutputFiles(const OutputFiles&) = delete;
+    OutputFiles& operator=(const OutputFiles&) = delete;
+
+    parquet::arrow::FileWriter& writer() { return *writer_; }
+    arrow::io::OutputStream& sink() { return *sink_; }
+
+    /**
+     * @brief Opens the first file, or the next part after close_part().
+     */
+    arrow::Status open() {
+        ARROW_ASSIGN_OR_RAISE(sink_, arrow::io::FileOutputStream::Open(atomic_ ? temp_path() : file_path()));
+        ARROW_ASSIGN_OR_RAISE(writer_, parquet::arrow::FileWriter::Open(*schema_, pool_, sink_, properties_, arrow_properties_));
+        return writer_->AddKeyValueMetadata(metadata_);
+    }
+
+    /**
+     * @brief Finishes the current file and moves it into place.
+     *
+     * @return int64_t The size of the finished file.
+     */
+    arrow::Result<int64_t> close_part() {
+        ARROW_RETURN_NOT_OK(writer_->Close());
+        ARROW_ASSIGN_OR_RAISE(const int64_t size, sink_->Tell());
+        ARROW_RETURN_NOT_OK(sink_->Close());
+        const auto footer = writer_->metadata();
+        sink_.reset();
+        writer_.reset();
+        if (atomic_) {
+            std::error_code ec;
+            std::filesystem::rename(temp_path(), file_path(), ec);
+            if (ec) return arrow::Status::IOError("Cannot rename ", temp_path(), " to ", file_path(), ": ", ec.message());
+        }
+        written_.push_back(file_path());
+        if (summary_) summary_->add(file_path(), footer);
+        part_++;
+        return size;
+    }
+
+    /**
+     * @brief Closes the last file; the output is complete.
+     */
+    arrow::Status finish() {
+        ARROW_RETURN_NOT_OK(close_part().status());
+        finished_ = true;
+        // Parts are numbered without gaps, so the stale ones end at the first missing number
+        std::error_code ec;
+        int part = split_ ? part_ : 0;
+        while (std::filesystem::remove(part_path(path_, part), ec)) part++;
+        if (ec) return arrow::Status::IOError("Cannot remove ", part_path(path_, part), ": ", ec.message());
+        // Nor does split output keep the unsplit file of an earlier conversion
+        if (split_) {
+            std::filesystem::remove(path_, ec);
+            if (ec) return arrow::Status::IOError("Cannot remove ", path_, ": ", ec.message());
+        }
+        return arrow::Status::OK();
+    }
+
+private:
+    std::string file_path() const { return split_ ? part_path(path_, part_) : path_; }
+    std::string temp_path() const {
+        const std::filesystem::path file(file_path());
+        return (file.parent_path() / ("." + file.filename().string() + ".tmp")).string();
+    }
+
+    const std::string path_;
+    const bool split_;
+    const bool atomic_;
+    const std::shared_ptr<arrow::Schema> schema_;
+    arrow::MemoryPool* pool_;
+    const std::shared_ptr<parquet::WriterProperties> properties_;
+    const std::shared_ptr<parquet::ArrowWriterProperties> arrow_properties_;
+    const std::shared_ptr<const arrow::KeyValueMetadata> metadata_;
+    DatasetSummary* summary_;
+    std::shared_ptr<arrow::io::FileOutputStream> sink_;
+    std::unique_ptr<parquet::arrow::FileWriter> writer_;
+    std::vector<std::string> written_;
+    int part_ = 0;
+    bool finished_ = false;
+};
+
+/*! \class RowGroupCutter
+	\brief Appends batches to the writer and decides where row groups and files end
+
+	The writer buffers the encoded pages of the current row group until it
+	is closed. A row group ends when it reaches its target length, slicing
+	the batch at the boundary; never because of the memory budget, which
+	depends on whatever else the process is doing, so the same input always
+	gives the same file. With a byte target, the size of each closed row
+	group in the output corrects the length of the next one. The last batch never starts a new row group,
+	which would end up empty. Every batch first goes through the check of
+	the declared sort order.
+
+	Split output rolls over to the next file at a row group boundary: exactly
+	at --max-file-rows, or under --max-file-bytes once the row group being
+	closed and one more like it would not fit, judging by the bytes per row
+	of the groups written so far, with some margin.
+*/
+class RowGroupCutter {
+    /*! allowance for row groups, and the footer, coming out larger than estimated */
+    static constexpr double kFileBytesMargin = 1.1;
+
+public:
+    RowGroupCutter(OutputFiles& files, const ConvertOptions& options, const int64_t target_rows, const double row_bytes, SortOrderCheck& order)
+        : files_(files), order_(order), max_rows_(options.row_group_rows),
+          target_bytes_(options.row_group_bytes), max_file_rows_(options.max_file_rows), max_file_bytes_(options.max_file_bytes),
+          target_rows_(target_rows), row_bytes_(row_bytes) {}
+
+    arrow::Status write(const arrow::RecordBatch& batch, const bool last) {
+        ARROW_RETURN_NOT_OK(order_.check(batch));
+        if (group_start_ < 0) {
+            ARROW_ASSIGN_OR_RAISE(group_start_, files_.sink().Tell());
+        }
+
+        const int64_t num_rows = batch.num_rows();
+        for (int64_t offset = 0; offset < num_rows || offset == 0;) {
+            int64_t rows = num_rows - offset;
+            if (target_rows_ > 0) rows = std::min(rows, target_rows_ - group_rows_);
+            if (max_file_rows_ > 0) rows = std::min(rows, max_file_rows_ - file_rows_);
+            if (rows == num_rows) ARROW_RETURN_NOT_OK(files_.writer().WriteRecordBatch(batch));
+            else ARROW_RETURN_NOT_OK(files_.writer().WriteRecordBatch(*batch.Slice(offset, rows)));
+            offset += rows;
+            group_rows_ += rows;
+            file_rows_ += rows;
+
+            if (last && offset >= num_rows) break;
+            if (max_file_rows_ > 0 && file_rows_ >= max_file_rows_) ARROW_RETURN_NOT_OK(roll());
+            else if (target_rows_ > 0 && group_rows_ >= target_rows_) ARROW_RETURN_NOT_OK(cut());
+            if (rows == 0) break;
+        }
+        return arrow::Status::OK();
+    }
+
+private:
+    arrow::Status cut() {
+        if (max_file_bytes_ > 0) {
+            ARROW_ASSIGN_OR_RAISE(const int64_t position, files_.sink().Tell());
+            const double group_bytes = row_bytes_ * static_cast<double>(group_rows_) * kFileBytesMargin;
+            if (static_cast<double>(position) + 2 * group_bytes > static_cast<double>(max_file_bytes_)) return roll();
+        }
+
+        ARROW_RETURN_NOT_OK(files_.writer().NewBufferedRowGroup());
+        if (target_bytes_ > 0 || max_file_bytes_ > 0) {
+            ARROW_ASSIGN_OR_RAISE(const int64_t position, files_.sink().Tell());
+            const int64_t written = position - group_start_;
+            if (written > 0 && group_rows_ > 0) {
+                row_bytes_ = static_cast<double>(written) / static_cast<double>(group_rows_);
+                if (target_bytes_ > 0) {
+                    target_rows_ = std::clamp(static_cast<int64_t>(target_bytes_ / row_bytes_), kMinRowGroupRows, kMaxRowGroupRows);
+                    if (max_rows_ > 0) target_rows_ = std::min(target_rows_, max_rows_);
+                }
+            }
+            group_start_ = position;
+        }
+        group_rows_ = 0;
+        return arrow::Status::OK();
+    }
+
+    arrow::Status roll() {
+        ARROW_ASSIGN_OR_RAISE(const int64_t size, files_.close_part());
+        // The footer is counted too, which only makes the estimate a little safer
+        if (size > group_start_ && group_rows_ > 0) row_bytes_ = static_cast<double>(size - group_start_) / static_cast<double>(group_rows_);
+        ARROW_RETURN_NOT_OK(files_.open());
+        ARROW_ASSIGN_OR_RAISE(group_start_, files_.sink().Tell());
+        group_rows_ = 0;
+        file_rows_ = 0;
+        return arrow::Status::OK();
+    }
+
+    OutputFiles& files_;
+    SortOrderCheck& order_;
+    const int64_t max_rows_;
+    const int64_t target_bytes_;
+    const int64_t max_file_rows_;
+    const int64_t max_file_bytes_;
+    int64_t target_rows_;
+    double row_bytes_;
+    int64_t group_rows_ = 0;
+    int64_t group_start_ = -1;
+    int64_t file_rows_ = 0;
+};
+
+/**
+ * @brief Bounded reorder buffer between batch producers and the writer.
+ *
+ * Producers claim batch indices in row order and may finish them out of
+ * order; the writer takes them back strictly in order. A producer cannot
+ * claim a batch more than `depth` batches ahead of the writer, which bounds
+ * the number of decoded batches held in memory. While a memory budget is
+ * exceeded, producers also wait for the writer to drain the batches already
+ * in flight before claiming new ones.
+ */
+class OrderedBatchQueue {
+public:
+    OrderedBatchQueue(const int64_t num_batches, const int depth, const MemoryBudget* budget)
+        : num_batches_(num_batches), depth_(std::max(1, depth)), budget_(budget) {}
+
+    /**
+     * @brief Claims the next batch to build, waiting while the window is full.
+     *
+     * Budget usage changes without notification, so a stalled producer
+     * re-checks it periodically. Once nothing is in flight it always proceeds.
+     *
+     * @return int64_t The batch index, or -1 when every batch is claimed or the pipeline failed.
+     */
+    int64_t claim() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto can_claim = [&] {
+            if (!status_.ok() || next_claim_ >= num_batches_) return true;
+            if (next_claim_ >= next_write_ + depth_) return false;
+            return !budget_ || !budget_->exceeded() || next_claim_ == next_write_;
+        };
+        while (!can_claim()) space_cv_.wait_for(lock, std::chrono::milliseconds(10));
+        if (!status_.ok() || next_claim_ >= num_batches_) return -1;
+        return next_claim_++;
+    }
+
+    /**
+     * @brief Hands a built batch to the writer.
+     */
+    void push(const int64_t index, std::shared_ptr<arrow::RecordBatch> batch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_[index] = std::move(batch);
+        }
+        ready_cv_.notify_one();
+    }
+
+    /**
+     * @brief Takes the next batch in row order, waiting until it is built.
+     *
+     * @return std::shared_ptr<arrow::RecordBatch> The batch, or nullptr after the last one.
+     */
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_cv_.wait(lock, [&] { return !status_.ok() || next_write_ >= num_batches_ || ready_.count(next_write_) > 0; });
+        ARROW_RETURN_NOT_OK(status_);
+        if (next_write_ >= num_batches_) return nullptr;
+
+        auto node = ready_.extract(next_write_++);
+        lock.unlock();
+        space_cv_.notify_all();
+        return std::move(node.mapped());
+    }
+
+    /**
+     * @brief Stops the pipeline; pending and future calls return right away.
+     */
+    void abort(const arrow::Status& status) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (status_.ok()) status_ = status;
+        }
+        space_cv_.notify_all();
+        ready_cv_.notify_all();
+    }
+
+private:
+    const int64_t num_batches_;
+    const int64_t depth_;
+    const MemoryBudget* budget_;
+    std::mutex mutex_;
+    std::condition_variable space_cv_;
+    std::condition_variable ready_cv_;
+    std::map<int64_t, std::shared_ptr<arrow::RecordBatch>> ready_;
+    int64_t next_claim_ = 0;
+    int64_t next_write_ = 0;
+    arrow::Status status_;
+};
+
+/*! Takes the batches of an output in row order; `last` marks the final one. */
+using BatchSink = std::function<arrow::Status(const arrow::RecordBatch& batch, bool last)>;
+
+/**
+ * @brief Builds batches on several producer threads and writes them in row order.
+ *
+ * Each producer owns a batch context and reads its row ranges from the shared,
+ * read-only DBF buffer. The calling thread is the only writer, so the output
+ * is byte-identical to the serial path: a batch's contents, dictionaries
+ * included, depend only on its rows. Parquet gets dictionary columns as
+ * strings (plain_dictionaries) and Arrow IPC remaps them onto the file's
+ * dictionaries (IpcDictionaries) in row order.
+ *
+ * @param dbf The DBF file structure.
+ * @param out The columns and rows of the output.
+ * @param specs The decoding plan of every column.
+ * @param options Conversion options (batch size, workers, queue depth).
+ * @param writer Receives the batches, such as a Parquet writer behind its row group cutter.
+ * @param pool Memory pool for the batches.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status write_batches_pipelined(const DBF& dbf, const OutputRows& out, const std::vector<ColumnSpec>& specs,
+                                             const ConvertOptions& options, const BatchSink& writer, arrow::MemoryPool* pool) {
+    const int batch_size = options.batch_size;
+    const int64_t num_batches = (out.num_rows + batch_size - 1) / batch_size;
+    const int workers = static_cast<int>(std::min<int64_t>(options.workers, std::max<int64_t>(num_batches, 1)));
+
+    std::vector<std::unique_ptr<BatchContext>> contexts;
+    for (int i = 0; i < workers; i++) {
+        ARROW_ASSIGN_OR_RAISE(auto ctx, make_batch_context(dbf, out.schema, specs, batch_size, pool, out.columns));
+        contexts.push_back(std::move(ctx));
+    }
+
+    const MemoryBudget* budget = options.memory_budget.get();
+    OrderedBatchQueue queue(num_batches, options.queue_depth > 0 ? options.queue_depth : 2 * workers, budget);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back([&, i] {
+            for (int64_t index = queue.claim(); index >= 0; index = queue.claim()) {
+                const int64_t start = index * batch_size;
+                auto batch = create_arrow_batch(dbf, out.schema, *contexts[i], start, std::min<int64_t>(batch_size, out.num_rows - start), out.rows);
+                if (!batch.ok()) {
+                    queue.abort(batch.status());
+                    return;
+                }
+                queue.push(index, std::move(*batch));
+            }
+        });
+    }
+
+    arrow::Status status;
+    for (int64_t index = 0; status.ok(); index++) {
+        auto batch = queue.pop();
+        if (!batch.ok()) status = batch.status();
+        else if (!*batch) break;
+        else status = writer(**batch, index + 1 == num_batches);
+    }
+    if (!status.ok()) queue.abort(status);
+
+    for (auto& thread : threads) thread.join();
+    return status;
+}
+
+/**
+ * @brief Builds the batches of an output and hands them over in row order,
+ * on the pipeline when there are several workers.
+ *
+ * @param dbf The DBF file structure.
+ * @param out The columns and rows of the output.
+ * @param specs The decoding plan of every column.
+ * @param options Conversion options (batch size, workers, queue depth).
+ * @param writer Receives the batches.
+ * @param pool Memory pool for the batches.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status write_batches(const DBF& dbf, const OutputRows& out, const std::vector<ColumnSpec>& specs,
+                                   const ConvertOptions& options, const BatchSink& writer, arrow::MemoryPool* pool) {
+    if (options.workers > 1) return write_batches_pipelined(dbf, out, specs, options, writer, pool);
+
+    const int batch_size = options.batch_size;
+    ARROW_ASSIGN_OR_RAISE(auto ctx, make_batch_context(dbf, out.schema, specs, batch_size, pool, out.columns));
+    for (int64_t start = 0; start < out.num_rows; start += batch_size) {
+        const int64_t rows = std::min<int64_t>(batch_size, out.num_rows - start);
+        ARROW_ASSIGN_OR_RAISE(auto record_batch, create_arrow_batch(dbf, out.schema, *ctx, start, rows, out.rows));
+        ARROW_RETURN_NOT_OK(writer(*record_batch, start + batch_size >= out.num_rows));
+    }
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Turns the dictionary columns of an output into plain strings for the Parquet writer.
+ *
+ * Arrow's Parquet writer falls back to plain encoding for the rest of a
+ * column chunk as soon as a batch comes with a dictionary other than the
+ * first one's, which batches built on their own always do. Given strings,
+ * the Parquet encoder builds the dictionary of each column chunk itself.
+ * Parquet has no dictionary logical type either way: the original schema is
+ * serialized into the `ARROW:schema` key-value metadata, as store_schema()
+ * would, and readers restore the dictionary type from it.
+ *
+ * @param out The columns and rows of the output.
+ * @param metadata Key-value metadata of the file; receives the original schema.
+ * @param pool Memory pool for the serialized schema.
+ * @return arrow::Result<OutputRows> The output with string columns, or `out` if it has no dictionary.
+ */
+static arrow::Result<OutputRows> plain_dictionaries(const OutputRows& out, arrow::KeyValueMetadata& metadata, arrow::MemoryPool* pool) {
+    arrow::FieldVector fields;
+    bool any = false;
+    for (const auto& field : out.schema->fields()) {
+        if (field->type()->id() == arrow::Type::DICTIONARY) {
+            fields.push_back(field->WithType(static_cast<const arrow::DictionaryType&>(*field->type()).value_type()));
+            any = true;
+        } else {
+            fields.push_back(field);
+        }
+    }
+    if (!any) return out;
+
+    ARROW_ASSIGN_OR_RAISE(const auto serialized, arrow::ipc::SerializeSchema(*out.schema, pool));
+    metadata.Append("ARROW:schema", arrow::util::base64_encode(std::string_view(*serialized)));
+    OutputRows plain = out;
+    plain.schema = arrow::schema(std::move(fields), out.schema->metadata());
+    return plain;
+}
+
+/**
+ * @brief Writes some columns and rows of a DBF file to one Parquet file, or to its parts.
+ *
+ * @param dbf The DBF file structure.
+ * @param output The columns and rows to write.
+ * @param specs The decoding plan of every column.
+ * @param path The output path for the Parquet file.
+ * @param options Conversion options (batch size, pipeline, writer settings).
+ * @param atomic Write under a temporary name and rename once complete.
+ * @param pool Memory pool for the batches and the writer.
+ * @param summary Receives the footer of each file written, or nullptr.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status write_rows(const DBF& dbf, const OutputRows& output, const std::vector<ColumnSpec>& specs, const std::string& path,
+                                const ConvertOptions& options, const bool atomic, arrow::MemoryPool* pool, DatasetSummary* summary) {
+    parquet::WriterProperties::Builder props_builder;
+    props_builder.memory_pool(pool);
+    ARROW_ASSIGN_OR_RAISE(const auto compression, resolve_column_compression(*output.schema, options));
+    const auto metadata = configure_compression(*output.schema, compression, props_builder);
+    ARROW_ASSIGN_OR_RAISE(const OutputRows out, plain_dictionaries(output, *metadata, pool));
+    const auto& schema = out.schema;
+    const int64_t first_row_group_rows = configure_row_groups(dbf, schema->num_fields(), options, props_builder);
+    if (options.adaptive_encoding) ARROW_RETURN_NOT_OK(choose_column_encodings(dbf, out, specs, compression, pool, props_builder));
+    SortOrderCheck order(*schema, configure_indexes(dbf, out, options, props_builder));
+    auto writer_properties = props_builder.build();
+
+    parquet::ArrowWriterProperties::Builder arrow_props_builder;
+    // Encode and compress the column chunks of each batch in parallel, on the same CPU pool as decoding.
+    if (arrow::GetCpuThreadPoolCapacity() > 1) {
+        arrow_props_builder.set_use_threads(true);
+        arrow_props_builder.set_executor(arrow::internal::GetCpuThreadPool());
+    }
+    auto arrow_properties = arrow_props_builder.build();
+
+    const bool split = options.max_file_bytes > 0 || options.max_file_rows > 0;
+    OutputFiles files(path, split, atomic, schema, pool, writer_properties, arrow_properties, metadata, summary);
+    ARROW_RETURN_NOT_OK(files.open());
+
+    const double row_bytes = std::max(1.0, dbf.header->record_length / kAssumedCompressionRatio);
+    RowGroupCutter cutter(files, options, first_row_group_rows, row_bytes, order);
+    ARROW_RETURN_NOT_OK(write_batches(
+        dbf, out, specs, options, [&](const arrow::RecordBatch& batch, const bool last) { return cutter.write(batch, last); }, pool));
+    return files.finish();
+}
+
+/*! \class IpcDictionaries
+	\brief One growing dictionary per dictionary column of an Arrow IPC file
+
+	Each batch is built with dictionaries of its own, but an IPC file allows
+	a single dictionary per column, which later batches may only extend. The
+	values of each batch's dictionary are added to the column's dictionary
+	in order of first appearance and the batch's indices are remapped to it,
+	so every dictionary written starts with the previous one and goes out as
+	a delta.
+*/
+class IpcDictionaries {
+public:
+    IpcDictionaries(const arrow::Schema& schema, arrow::MemoryPool* pool) : pool_(pool), columns_(schema.num_fields()) {}
+
+    /**
+     * @brief Returns the batch with its dictionary columns remapped to the file's dictionaries.
+     */
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> unify(const arrow::RecordBatch& batch) {
+        std::vector<std::shared_ptr<arrow::Array>> arrays = batch.columns();
+        for (int col = 0; col < batch.num_columns(); col++) {
+            if (arrays[col]->type_id() != arrow::Type::DICTIONARY) continue;
+            const auto& indices = static_cast<const arrow::DictionaryArray&>(*arrays[col]);
+            const auto& values = static_cast<const arrow::StringArray&>(*indices.dictionary());
+            Column& column = columns_[col];
+
+            std::vector<int32_t> transpose(values.length());
+            bool grown = !column.dictionary;
+            for (int64_t i = 0; i < values.length(); i++) {
+                const auto [it, inserted] = column.ids.emplace(std::string(values.GetView(i)), static_cast<int32_t>(column.ids.size()));
+                if (inserted) {
+                    column.values.push_back(&it->first);
+                    grown = true;
+                }
+                transpose[i] = it->second;
+            }
+            if (grown) {
+                arrow::StringBuilder builder(pool_);
+                for (const std::string* value : column.values) ARROW_RETURN_NOT_OK(builder.Append(*value));
+                ARROW_RETURN_NOT_OK(builder.Finish(&column.dictionary));
+            }
+            ARROW_ASSIGN_OR_RAISE(arrays[col], indices.Transpose(indices.type(), column.dictionary, transpose.data(), pool_));
+        }
+        return arrow::RecordBatch::Make(batch.schema(), batch.num_rows(), std::move(arrays));
+    }
+
+private:
+    /*! \struct Column
+    	\brief The dictionary of one column so far
+    */
+    struct Column {
+        std::unordered_map<std::string, int32_t> ids;
+        /*! the keys of `ids` in index order */
+        std::vector<const std::string*> values;
+        std::shared_ptr<arrow::Array> dictionary;
+    };
+
+    arrow::MemoryPool* pool_;
+    std::vector<Column> columns_;
+};
+
+/**
+ * @brief Writes some columns and rows of a DBF file to an Arrow IPC file (--format arrow).
+ *
+ * The batches go to the file as built, with no encoding step; uncompressed,
+ * the file is the in-memory layout and readers can memory-map it. The
+ * Parquet writer settings do not apply. Like Parquet output, the file is
+ * written under a hidden temporary name and renamed once complete, so
+ * readers never map a partial file.
+ *
+ * @param dbf The DBF file structure.
+ * @param out The columns and rows to write.
+ * @param specs The decoding plan of every column.
+ * @param path The output path for the Arrow file.
+ * @param options Conversion options (batch size, pipeline, buffer codec).
+ * @param pool Memory pool for the batches and the writer.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status write_arrow_file(const DBF& dbf, const OutputRows& out, const std::vector<ColumnSpec>& specs, const std::string& path,
+                                      const ConvertOptions& options, arrow::MemoryPool* pool) {
+    auto ipc_options = arrow::ipc::IpcWriteOptions::Defaults();
+    ipc_options.memory_pool = pool;
+    ipc_options.emit_dictionary_deltas = true;
+    const CompressionSpec& compression = options.ipc_compression;
+    if (!compression.codec.empty() && compression.codec != "uncompressed") {
+        ARROW_ASSIGN_OR_RAISE(const auto type, arrow::util::Codec::GetCompressionType(compression.codec));
+        ARROW_ASSIGN_OR_RAISE(ipc_options.codec,
+                              arrow::util::Codec::Create(type, compression.level.value_or(arrow::util::kUseDefaultCompressionLevel)));
+    }
+
+    const std::filesystem::path target(path);
+    const std::string temp_path = (target.parent_path() / ("." + target.filename().string() + ".tmp")).string();
+    auto status = [&]() -> arrow::Status {
+        ARROW_ASSIGN_OR_RAISE(auto sink, arrow::io::FileOutputStream::Open(temp_path));
+        ARROW_ASSIGN_OR_RAISE(auto writer, arrow::ipc::MakeFileWriter(sink, out.schema, ipc_options));
+        IpcDictionaries dictionaries(*out.schema, pool);
+        ARROW_RETURN_NOT_OK(write_batches(
+            dbf, out, specs, options,
+            [&](const arrow::RecordBatch& batch, bool) -> arrow::Status {
+                ARROW_ASSIGN_OR_RAISE(const auto unified, dictionaries.unify(batch));
+                return writer->WriteRecordBatch(*unified);
+            },
+            pool));
+        ARROW_RETURN_NOT_OK(writer->Close());
+        return sink->Close();
+    }();
+
+    std::error_code ec;
+    if (status.ok()) {
+        std::filesystem::rename(temp_path, path, ec);
+        if (ec) status = arrow::Status::IOError("Cannot rename ", temp_path, " to ", path, ": ", ec.message());
+    }
+    if (!status.ok()) std::filesystem::remove(temp_path, ec);
+    return status;
+}
+
+/*! directory value Hive gives null partition keys */
+static constexpr std::string_view kHiveNullPartition = "__HIVE_DEFAULT_PARTITION__";
+
+/**
+ * @brief Percent-escapes a partition value for a directory name, as Hive does.
+ */
+static std::string escape_partition_value(const std::string_view value) {
+    static constexpr std::string_view kEscaped = "\"#%'*/:=?\\{[]^";
+    std::string escaped;
+    for (const char c : value) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (byte < 0x20 || byte == 0x7F || kEscaped.find(c) != std::string_view::npos) {
+            char hex[4];
+            std::snprintf(hex, sizeof(hex), "%%%02X", byte);
+            escaped += hex;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * @brief Formats a decoded value as it appears in a partition directory.
+ *
+ * Nulls and empty strings both go to kHiveNullPartition, as in Hive: a
+ * `COL=` directory reads back as null anyway.
+ */
+static std::string partition_value(const arrow::Array& array, const int64_t i) {
+    if (array.IsNull(i)) return std::string(kHiveNullPartition);
+    switch (array.type_id()) {
+        case arrow::Type::BOOL:
+            return static_cast<const arrow::BooleanArray&>(array).Value(i) ? "true" : "false";
+        case arrow::Type::INT32:
+            return std::to_string(array.data()->GetValues<int32_t>(1)[i]);
+        case arrow::Type::INT64:
+            return std::to_string(array.data()->GetValues<int64_t>(1)[i]);
+        case arrow::Type::DATE32:
+            return civil_from_days(array.data()->GetValues<int32_t>(1)[i]);
+        case arrow::Type::TIMESTAMP: {
+            const int64_t millis = array.data()->GetValues<int64_t>(1)[i];
+            const int64_t seconds = millis / 1000 - (millis % 1000 < 0);
+            const int64_t days = seconds / 86400 - (seconds % 86400 < 0);
+            const int64_t second_of_day = seconds - days * 86400;
+            char time[16];
+            std::snprintf(time, sizeof(time), " %02d:%02d:%02d", static_cast<int>(second_of_day / 3600),
+                          static_cast<int>(second_of_day / 60 % 60), static_cast<int>(second_of_day % 60));
+            return civil_from_days(static_cast<int32_t>(days)) + time;
+        }
+        case arrow::Type::DOUBLE: {
+            char text[32];
+            const auto result = std::to_chars(text, text + sizeof(text), array.data()->GetValues<double>(1)[i]);
+            return std::string(text, result.ptr);
+        }
+        case arrow::Type::DECIMAL128:
+            return static_cast<const arrow::Decimal128Array&>(array).FormatValue(i);
+        default: {
+            const std::string_view text = string_value(array, i);
+            return text.empty() ? std::string(kHiveNullPartition) : std::string(text);
+        }
+    }
+}
+
+/*! \struct Partition
+	\brief The rows of one partition directory, in output order
+*/
+struct Partition {
+    std::string directory;
+    std::vector<uint32_t> rows;
+};
+
+/**
+ * @brief Groups rows by the values of the --partition-by columns.
+ *
+ * Rows are looked up by the raw bytes of their key fields, so only the
+ * first row of each distinct byte pattern is decoded to name its directory.
+ * Patterns that decode to the same values (" 7" and "7 " in a numeric
+ * field, say) end up in the same partition.
+ *
+ * @param dbf The DBF file structure.
+ * @param all Every column and row of the output, in output order.
+ * @param key_columns Schema positions of the partition columns.
+ * @param specs The decoding plan of every column.
+ * @param pool Memory pool for the decoded keys.
+ * @return std::vector<Partition> The partitions in order of first appearance.
+ */
+static arrow::Result<std::vector<Partition>> group_partitions(const DBF& dbf, const OutputRows& all, const std::vector<int>& key_columns,
+                                                              const std::vector<ColumnSpec>& specs, arrow::MemoryPool* pool) {
+    arrow::FieldVector key_fields;
+    std::vector<int> key_dbf_columns;
+    for (const int field : key_columns) {
+        key_fields.push_back(all.schema->field(field));
+        key_dbf_columns.push_back(all.columns[field]);
+    }
+    const auto key_schema = arrow::schema(key_fields);
+    ARROW_ASSIGN_OR_RAISE(auto ctx, make_batch_context(dbf, key_schema, specs, 1, pool, key_dbf_columns));
+
+    std::vector<Partition> partitions;
+    std::unordered_map<std::string, size_t> by_directory;
+    std::unordered_map<std::string, size_t> by_raw_key;
+    const unsigned char* records = dbf.mem_buffer.data() + dbf.header->header_length;
+    const size_t record_length = dbf.header->record_length;
+    std::string raw_key;
+    for (int64_t i = 0; i < all.num_rows; i++) {
+        const uint32_t row = all.rows ? all.rows[i] : static_cast<uint32_t>(i);
+        const unsigned char* record = records + row * record_length;
+        raw_key.clear();
+        for (const int col : key_dbf_columns) {
+            raw_key.append(reinterpret_cast<const char*>(record + dbf.fields[col].field_offset), dbf.fields[col].field_length);
+        }
+
+        auto known = by_raw_key.find(raw_key);
+        if (known == by_raw_key.end()) {
+            ARROW_ASSIGN_OR_RAISE(auto batch, create_arrow_batch(dbf, key_schema, *ctx, 0, 1, &row));
+            std::string directory;
+            for (int k = 0; k < batch->num_columns(); k++) {
+                if (k > 0) directory += '/';
+                directory += escape_partition_value(key_fields[k]->name()) + "=" + escape_partition_value(partition_value(*batch->column(k), 0));
+            }
+            const auto [entry, added] = by_directory.emplace(directory, partitions.size());
+            if (added) partitions.push_back(Partition{directory, {}});
+            known = by_raw_key.emplace(raw_key, entry->second).first;
+        }
+        partitions[known->second].rows.push_back(row);
+    }
+    return partitions;
+}
+
+/**
+ * @brief Removes the files an earlier conversion left in partitions this one did not write.
+ *
+ * Only files named after the output, or its split parts, are removed, and
+ * only from directories nested like the partition columns; directories left
+ * empty are removed too.
+ *
+ * @param directory The directory at this level of the partition tree.
+ * @param relative Its path under the partition root, as Partition::directory.
+ * @param prefixes `COLUMN=` of every partition column, outermost first.
+ * @param name File name of the output.
+ * @param written Partition directories written by this conversion.
+ */
+static void remove_stale_partitions(const std::filesystem::path& directory, const std::string& relative, const std::vector<std::string>& prefixes,
+                                    const std::string& name, const std::unordered_set<std::string>& written) {
+    std::error_code ec;
+    const size_t level = relative.empty() ? 0 : static_cast<size_t>(std::count(relative.begin(), relative.end(), '/')) + 1;
+    if (level == prefixes.size()) {
+        if (written.count(relative) > 0) return;
+        const std::string file = (directory / name).string();
+        std::filesystem::remove(file, ec);
+        for (int part = 0; std::filesystem::remove(part_path(file, part), ec); part++) {}
+        return;
+    }
+
+    std::vector<std::filesystem::path> children;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(ec) && it->path().filename().string().rfind(prefixes[level], 0) == 0) children.push_back(it->path());
+    }
+    for (const auto& child : children) {
+        const std::string child_name = child.filename().string();
+        remove_stale_partitions(child, relative.empty() ? child_name : relative + "/" + child_name, prefixes, name, written);
+        std::filesystem::remove(child, ec);  // only if it is now empty
+    }
+}
+
+/**
+ * @brief Writes a DBF file as a Hive-partitioned dataset.
+ *
+ * The partition directories go under the directory of `path`, each holding
+ * a file named like `path` with the rows of that partition and without the
+ * partition columns, whose values are in the directory names. Up to
+ * options.partition_writers partitions are written at a time, each file
+ * completely before the next is opened, so the number of open files stays
+ * bounded however many partitions there are. Every file is written under a
+ * hidden temporary name and renamed once complete. Once every partition is
+ * written, the files of partitions that an earlier conversion wrote and this
+ * one did not are removed, so the dataset holds only this conversion's rows.
+ *
+ * @param dbf The DBF file structure.
+ * @param all Every column and row of the output, in output order.
+ * @param specs The decoding plan of every column.
+ * @param path The output path the partition files are named after.
+ * @param options Conversion options.
+ * @param pool Memory pool for the batches and the writers.
+ * @param summary Receives the footer of each file written, or nullptr.
+ * @return arrow::Status OK on success.
+ */
+static arrow::Status write_partitions(const DBF& dbf, const OutputRows& all, const std::vector<ColumnSpec>& specs, const std::string& path,
+                                      const ConvertOptions& options, arrow::MemoryPool* pool, DatasetSummary* summary) {
+    std::vector<int> key_columns;
+    for (const auto& name : options.partition_by) {
+        const int field = all.schema->GetFieldIndex(name);
+        if (field < 0) return arrow::Status::Invalid("--partition-by: no column ", name);
+        key_columns.push_back(field);
+    }
+
+    OutputRows data;
+    arrow::FieldVector data_fields;
+    for (int field = 0; field < all.schema->num_fields(); field++) {
+        if (std::count(key_columns.begin(), key_columns.end(), field) > 0) continue;
+        data_fields.push_back(all.schema->field(field));
+        data.columns.push_back(all.columns[field]);
+    }
+    data.schema = arrow::schema(data_fields, all.schema->metadata());
+
+    ARROW_ASSIGN_OR_RAISE(const auto partitions, group_partitions(dbf, all, key_columns, specs, pool));
+    size_t row_list_bytes = 0;
+    for (const auto& partition : partitions) row_list_bytes += partition.rows.capacity() * sizeof(uint32_t);
+    const BudgetCharge rows_charge(options.memory_budget.get(), static_cast<int64_t>(row_list_bytes));
+
+    const std::filesystem::path target(path);
+    const std::filesystem::path root = target.parent_path();
+    const std::string name = target.filename().string();
+
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    arrow::Status status;
+    auto write_partition = [&](const Partition& partition) -> arrow::Status {
+        const auto directory = root / partition.directory;
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) return arrow::Status::IOError("Cannot create ", directory.string(), ": ", ec.message());
+
+        OutputRows out = data;
+        out.rows = partition.rows.data();
+        out.num_rows = static_cast<int64_t>(partition.rows.size());
+        return write_rows(dbf, out, specs, (directory / name).string(), options, true, pool, summary);
+    };
+    auto writer = [&] {
+        for (size_t i = next++; i < partitions.size(); i = next++) {
+            auto written = write_partition(partitions[i]);
+            if (!written.ok()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (status.ok()) status = written;
+                next = partitions.size();
+            }
+        }
+    };
+
+    const size_t writers = std::clamp<size_t>(options.partition_writers, 1, std::max<size_t>(partitions.size(), 1));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < writers; i++) threads.emplace_back(writer);
+    writer();
+    for (auto& thread : threads) thread.join();
+    ARROW_RETURN_NOT_OK(status);
+
+    std::vector<std::string> prefixes;
+    for (const auto& column : options.partition_by) prefixes.push_back(escape_partition_value(column) + "=");
+    std::unordered_set<std::string> written;
+    for (const auto& partition : partitions) written.insert(partition.directory);
+    remove_stale_partitions(root.empty() ? std::filesystem::path(".") : root, "", prefixes, name, written);
+    return arrow::Status::OK();
+}
+
+/**
+ * @brief Writes the contents of a DBF file to a Parquet file.
+ *
+ * @param dbf The DBF file structure.
+ * @param path The output path for the Parquet file.
+ * @param options Conversion options (batch size, type inference, pipeline).
+ * @return true If the Parquet file was successfully written.
+ * @return false If an error occurred during the writing process.
+ */
+arrow::Status write_parquet(const DBF& dbf, const std::string& path, const ConvertOptions& options) {
+    std::vector<ColumnSpec> specs;
+    ARROW_ASSIGN_OR_RAISE(auto schema, create_schema(dbf, options, specs));
+    if (!schema) return arrow::Status::Invalid("Schema creation failed.");
+    if (options.format == OutputFormat::kArrow && !options.single_file())
+        return arrow::Status::Invalid("--partition-by, --max-file-bytes and --max-file-rows only apply to Parquet output");
+    if (options.content_defined_chunking) {
+        const parquet::CdcOptions defaults;
+        const int64_t min_chunk = options.cdc_min_chunk_size > 0 ? options.cdc_min_chunk_size : defaults.min_chunk_size;
+        const int64_t max_chunk = options.cdc_max_chunk_size > 0 ? options.cdc_max_chunk_size : defaults.max_chunk_size;
+        if (min_chunk > max_chunk)
+            return arrow::Status::Invalid("content-defined chunks: minimum size ", min_chunk, " is above the maximum ", max_chunk);
+    }
+
+    // Files only end at row group boundaries; by default, leave room for a few groups per file
+    if (options.max_file_bytes > 0 && options.row_group_rows == 0 && options.row_group_bytes == 0) {
+        ConvertOptions split_options = options;
+        split_options.row_group_bytes = std::clamp<int64_t>(options.max_file_bytes / 8, 64 << 10, ConvertOptions::kAutoRowGroupBytes);
+        return write_parquet(dbf, path, split_options);
+    }
+
+    // Charge batches and the writer's buffered row group to the memory budget.
+    MemoryBudget* budget = options.memory_budget.get();
+    std::unique_ptr<BudgetedMemoryPool> budgeted_pool;
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+    if (budget) {
+        budgeted_pool = std::make_unique<BudgetedMemoryPool>(pool, budget);
+        pool = budgeted_pool.get();
+    }
+
+    std::vector<uint32_t> sorted_rows;
+    if (!options.sort_by.empty()) {
+        ARROW_ASSIGN_OR_RAISE(sorted_rows, sort_rows(dbf, schema, specs, options, pool, path));
+    }
+    const BudgetCharge order_charge(budget, static_cast<int64_t>(sorted_rows.size() * sizeof(uint32_t)));
+
+    OutputRows all;
+    all.schema = schema;
+    for (int col = 0; col < schema->num_fields(); col++) all.columns.push_back(col);
+    all.rows = sorted_rows.empty() ? nullptr : sorted_rows.data();
+    all.num_rows = dbf.header->records;
+
+    if (options.format == OutputFormat::kArrow) return write_arrow_file(dbf, all, specs, path, options, pool);
+
+    // Footers join the dataset summary only once the whole conversion has succeeded
+    std::unique_ptr<DatasetSummary> written;
+    if (options.dataset_summary) written = std::make_unique<DatasetSummary>(options.dataset_summary->root());
+
+    if (!options.partition_by.empty()) {
+        ARROW_RETURN_NOT_OK(write_partitions(dbf, all, specs, path, options, pool, written.get()));
+    } else {
+        ARROW_RETURN_NOT_OK(write_rows(dbf, all, specs, path, options, false, pool, written.get()));
+    }
+    if (written) options.dataset_summary->add(std::move(*written));
     return arrow::Status::OK();
 }
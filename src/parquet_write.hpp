@@ -16,12 +16,144 @@
 
 #ifndef PARQUET_WRITE_H
 #define PARQUET_WRITE_H
+#include "dataset_summary.hpp"
 #include "dbf_reader.hpp"
+#include "memory_budget.hpp"
+#include "schema_file.hpp"
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include <arrow/result.h>
 #include <arrow/status.h>
 
+/*! \struct CompressionSpec
+	\brief A codec and level, as given to --compression
+*/
+struct CompressionSpec {
+    /*! Arrow codec name (zstd, snappy, gzip, brotli, lz4_raw, uncompressed); empty keeps the file's codec */
+    std::string codec = "zstd";
+    /*! codec level; unset keeps the codec default */
+    std::optional<int> level;
+};
+
+/* parse_compression()
+ * Parses "CODEC", "CODEC:LEVEL" or a bare "LEVEL"; fails if Parquet or this Arrow build lacks the codec.
+ */
+arrow::Result<CompressionSpec> parse_compression(const std::string& text);
+
+/*! \struct SortKey
+	\brief One column of a row order
+*/
+struct SortKey {
+    std::string column;
+    bool descending = false;
+};
+
+/* parse_sort_keys()
+ * Parses "COL[:asc|:desc],..." into sort keys.
+ */
+arrow::Result<std::vector<SortKey>> parse_sort_keys(const std::string& text);
+
+/*! \enum OutputFormat
+	\brief File format a conversion writes
+*/
+enum class OutputFormat {
+    /*! Parquet, encoded and compressed for storage and query engines */
+    kParquet,
+    /*! Arrow IPC file (Feather v2), the in-memory layout as is, for local readers */
+    kArrow,
+};
+
+/* ConvertOptions
+ * Tuning knobs for a DBF to Parquet conversion.
+ */
+struct ConvertOptions {
+    /*! file format of the output; the Parquet writer settings below only apply to Parquet */
+    OutputFormat format = OutputFormat::kParquet;
+    /*! buffer codec of Arrow output (lz4 or zstd); uncompressed files can be memory-mapped by readers */
+    CompressionSpec ipc_compression{"uncompressed", std::nullopt};
+    /*! rows per record batch */
+    int batch_size = 10000;
+    /*! upgrade character columns to integer, date or dictionary when lossless */
+    bool infer_types = false;
+    /*! per-column types pinned by a schema file, if any */
+    std::shared_ptr<const SchemaOverrides> schema_overrides;
+    /*! threads building batches ahead of the writer; 1 builds and writes in turn */
+    int workers = 1;
+    /*! batches that may wait for the writer; 0 picks twice the worker count */
+    int queue_depth = 0;
+    /*! shared memory accounting and limit (--max-memory), if any */
+    std::shared_ptr<MemoryBudget> memory_budget;
+    /*! reusable decompression buffers kept between files, if any */
+    std::shared_ptr<BufferPool> buffer_pool;
+    /*! rows per row group; 0 keeps the writer default (1 Mi rows) */
+    int64_t row_group_rows = 0;
+    /*! target compressed bytes per row group; 0 for none */
+    int64_t row_group_bytes = 0;
+    /*! target size of a data page; 0 keeps the writer default, or derives it from row_group_bytes */
+    int64_t page_size = 0;
+    /*! dictionary size past which a column chunk falls back to plain encoding; 0 as for page_size */
+    int64_t dictionary_page_limit = 0;
+    /*! cut data pages at content-defined boundaries, so files that share rows share pages */
+    bool content_defined_chunking = false;
+    /*! smallest and largest content-defined chunk, before encoding; 0 keeps the writer default (256 KiB, 1 MiB) */
+    int64_t cdc_min_chunk_size = 0;
+    int64_t cdc_max_chunk_size = 0;
+    /*! normalization level of the chunk sizes; higher finds more boundaries and smaller pages */
+    int cdc_norm_level = 0;
+    /*! choose each column's encoding by trying the candidates on a sample */
+    bool adaptive_encoding = false;
+    /*! codec and level of every column */
+    CompressionSpec compression;
+    /*! codec or level of single columns, by name; columns absent from a file are ignored */
+    std::map<std::string, CompressionSpec> column_compression;
+    /*! columns given split-block bloom filters; columns absent from a file are ignored */
+    std::vector<std::string> bloom_filter_columns;
+    /*! false positive probability of the bloom filters */
+    double bloom_filter_fpp = 0.05;
+    /*! distinct values each bloom filter is sized for; 0 counts them in the file */
+    int64_t bloom_filter_ndv = 0;
+    /*! columns given a column and offset index; "*" for all */
+    std::vector<std::string> page_index_columns;
+    /*! order the rows are declared to follow, recorded as sorting_columns and checked while writing */
+    std::vector<SortKey> sorting_columns;
+    /*! columns the rows are sorted by before writing; implies sorting_columns */
+    std::vector<SortKey> sort_by;
+    /*! columns splitting the output into COL=value/ directories, dropped from the files */
+    std::vector<std::string> partition_by;
+    /*! partition files written at the same time, and so open at once */
+    int partition_writers = 4;
+    /*! split the output into name-00000.parquet onwards of at most this many bytes; 0 for no limit */
+    int64_t max_file_bytes = 0;
+    /*! split the output into files of at most this many rows; 0 for no limit */
+    int64_t max_file_rows = 0;
+    /*! collects the footer of every file written, for the _metadata of their directory, if any */
+    std::shared_ptr<DatasetSummary> dataset_summary;
+
+    /*! extension of the output files, with the dot */
+    const char* output_extension() const { return format == OutputFormat::kArrow ? ".arrow" : ".parquet"; }
+
+    /*! whether the output is the one file at the output path, rather than partitions or parts */
+    bool single_file() const { return partition_by.empty() && max_file_bytes == 0 && max_file_rows == 0; }
+
+    /*! row_group_bytes of --row-group-bytes auto */
+    static constexpr int64_t kAutoRowGroupBytes = int64_t{128} << 20;
+};
+
+/* parse_output_format()
+ * Parses "parquet", "arrow" or "arrow:CODEC[:LEVEL]" (lz4, zstd) into the format options.
+ */
+arrow::Status parse_output_format(const std::string& text, ConvertOptions& options);
+
+/* part_path()
+ * Path of one part of a split output: "name.parquet" becomes "name-00003.parquet".
+ */
+std::string part_path(const std::string& path, int index);
+
 /* write_Parquet()
- * Converts and saves the DBF data to a Parquet file.
+ * Converts and saves the DBF data to a Parquet file, or to an Arrow IPC file.
  */
-arrow::Status write_parquet(DBF& dbf, const std::string& path, int batch_size = 10000);
+arrow::Status write_parquet(const DBF& dbf, const std::string& path, const ConvertOptions& options = {});
 
 #endif
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * @file schema_file.cpp
+ * @brief Loads per-column schema overrides from a JSON file.
+ *
+ * A schema file pins the output type of columns by DBF field name, so that
+ * every file of a DATASUS system is exported with the same schema without
+ * relying on DB_FIELD or type inference:
+ *
+ * @code
+ * {
+ *   "system": "SIH RD",
+ *   "columns": {
+ *     "DT_INTER":  { "type": "date32" },
+ *     "NASC":      { "type": "date32", "date_format": "DDMMYYYY" },
+ *     "VAL_TOT":   { "type": "decimal", "precision": 12, "scale": 2 },
+ *     "MUNIC_RES": { "type": "string", "dictionary": true },
+ *     "IDADE":     { "type": "int32", "null_values": ["999"] }
+ *   }
+ * }
+ * @endcode
+ *
+ * Top-level keys other than "columns" are ignored and can be used for notes.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "json.hpp"
+#include "schema_file.hpp"
+
+/**
+ * @brief Maps a type name of the schema file to an OverrideType.
+ *
+ * @param name The type name.
+ * @return std::optional<OverrideType> The type, or nullopt if unknown.
+ */
+static std::optional<OverrideType> parse_type_name(const std::string& name) {
+    if (name == "string" || name == "utf8") return OverrideType::String;
+    if (name == "int32") return OverrideType::Int32;
+    if (name == "int64") return OverrideType::Int64;
+    if (name == "float64" || name == "double") return OverrideType::Float64;
+    if (name == "decimal" || name == "decimal128") return OverrideType::Decimal;
+    if (name == "date32" || name == "date") return OverrideType::Date32;
+    if (name == "bool" || name == "boolean") return OverrideType::Boolean;
+    return std::nullopt;
+}
+
+/**
+ * @brief Reads the override of one column from its JSON object.
+ *
+ * @param name The column name, for error messages.
+ * @param node The JSON object of the column.
+ * @return ColumnOverride The parsed override.
+ */
+static arrow::Result<ColumnOverride> parse_column(const std::string& name, const JsonValue& node) {
+    if (!node.is_object()) return arrow::Status::Invalid("schema file: column '", name, "' must be an object");
+
+    ColumnOverride column;
+    for (const auto& [key, value] : node.object) {
+        if (key == "type") {
+            if (!value.is_string()) return arrow::Status::Invalid("schema file: '", name, ".type' must be a string");
+            column.type = parse_type_name(value.string);
+            if (!column.type) return arrow::Status::Invalid("schema file: unknown type '", value.string, "' for column '", name, "'");
+        } else if (key == "precision" || key == "scale") {
+            if (!value.is_number()) return arrow::Status::Invalid("schema file: '", name, ".", key, "' must be a number");
+            (key == "precision" ? column.precision : column.scale) = static_cast<int>(value.number);
+        } else if (key == "dictionary") {
+            if (!value.is_bool()) return arrow::Status::Invalid("schema file: '", name, ".dictionary' must be true or false");
+            column.dictionary = value.boolean;
+        } else if (key == "date_format") {
+            if (!value.is_string() || (value.string != "YYYYMMDD" && value.string != "DDMMYYYY"))
+                return arrow::Status::Invalid("schema file: '", name, ".date_format' must be \"YYYYMMDD\" or \"DDMMYYYY\"");
+            column.day_first = value.string == "DDMMYYYY";
+        } else if (key == "null_values") {
+            if (!value.is_array()) return arrow::Status::Invalid("schema file: '", name, ".null_values' must be an array");
+            for (const auto& item : value.array) {
+                if (!item.is_string()) return arrow::Status::Invalid("schema file: '", name, ".null_values' must hold strings");
+                column.null_values.push_back(item.string);
+            }
+        } else {
+            return arrow::Status::Invalid("schema file: unknown key '", key, "' for column '", name, "'");
+        }
+    }
+
+    if (column.dictionary) {
+        if (column.type && *column.type != OverrideType::String)
+            return arrow::Status::Invalid("schema file: column '", name, "' can only be dictionary-encoded as a string");
+        column.type = OverrideType::String;
+    }
+    if (column.type == OverrideType::Decimal && (column.precision < 0 || column.precision > 38 || column.scale > 38))
+        return arrow::Status::Invalid("schema file: column '", name, "' has an invalid decimal precision or scale");
+
+    return column;
+}
+
+/**
+ * @brief Reads a JSON schema override file.
+ *
+ * @param path Path of the schema file.
+ * @return std::shared_ptr<const SchemaOverrides> The overrides, keyed by column name.
+ */
+arrow::Result<std::shared_ptr<const SchemaOverrides>> load_schema_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return arrow::Status::IOError("Cannot open schema file: ", path);
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    auto parsed = json_parse(contents.str());
+    if (!parsed.ok()) return parsed.status().WithMessage(path, ": ", parsed.status().message());
+
+    const JsonValue* columns = parsed->find("columns");
+    if (!columns || !columns->is_object()) return arrow::Status::Invalid(path, ": expected a \"columns\" object");
+
+    auto overrides = std::make_shared<SchemaOverrides>();
+    for (const auto& [name, node] : columns->object) {
+        ARROW_ASSIGN_OR_RAISE(overrides->columns[name], parse_column(name, node));
+    }
+
+    return overrides;
+}
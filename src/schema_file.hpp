@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * schema_file.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for schema_file.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef SCHEMA_FILE_H
+#define SCHEMA_FILE_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <arrow/result.h>
+
+/*! Output type a column can be pinned to. */
+enum class OverrideType { String, Int32, Int64, Float64, Decimal, Date32, Boolean };
+
+/*! \struct ColumnOverride
+	\brief Pinned type and parsing rules of one column
+*/
+struct ColumnOverride {
+    /*! output type; unset keeps the type derived from DB_FIELD */
+    std::optional<OverrideType> type;
+    /*! decimal precision; 0 takes the DBF field length */
+    int precision = 0;
+    /*! decimal scale; -1 takes the DBF decimal count */
+    int scale = -1;
+    /*! export strings dictionary-encoded */
+    bool dictionary = false;
+    /*! dates stored as DDMMYYYY instead of YYYYMMDD */
+    bool day_first = false;
+    /*! trimmed values that are exported as null */
+    std::vector<std::string> null_values;
+};
+
+/*! \struct SchemaOverrides
+	\brief Column overrides loaded from a schema file, keyed by DBF field name
+*/
+struct SchemaOverrides {
+    std::unordered_map<std::string, ColumnOverride> columns;
+};
+
+/* load_schema_file()
+ * Reads a JSON schema override file.
+ */
+arrow::Result<std::shared_ptr<const SchemaOverrides>> load_schema_file(const std::string& path);
+
+#endif
@@ -0,0 +1,515 @@
+/*****************************************************************************
+ * @file small_file_reader.cpp
+ * @brief Batched read-ahead of small DBC files for multi-file runs.
+ *
+ * Many DATASUS files are only a few hundred KB, and for those the
+ * open/seek/read sequence of dbc_load_dbf() costs more than decompressing
+ * them. SmallFileReader reads them ahead of the converting threads, in
+ * scheduling order, into fixed-size buffer slots. With io_uring, the opens
+ * of up to kBatch files go to the kernel in one io_uring_enter() call and
+ * their whole-file reads, into one registered arena, in the next; the
+ * closes ride along with the following batch. The ring is driven with raw
+ * syscalls, so there is no liburing dependency. Without io_uring (older
+ * kernels, seccomp filters, other systems) each file is read with pread().
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include "small_file_reader.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define DBC_HAVE_IO_URING 1
+#endif
+#endif
+
+/*! files submitted to the kernel together */
+static constexpr size_t kBatch = 32;
+
+#ifdef DBC_HAVE_IO_URING
+/*! user_data of close requests, whose completions are only counted */
+static constexpr uint64_t kCloseTag = ~0ull;
+/*! user_data of cancel requests, whose completions are ignored */
+static constexpr uint64_t kCancelTag = ~0ull - 1;
+/*! result of a request whose completion has not been reaped yet */
+static constexpr int kPending = INT_MIN;
+
+/*! An io_uring instance with its mapped submission and completion rings. */
+struct IoRing {
+    int fd = -1;
+    unsigned entries = 0;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_size = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    /*! queued but not yet submitted entries */
+    unsigned to_submit = 0;
+    /*! close requests whose completion has not been reaped */
+    unsigned closes_in_flight = 0;
+    /*! whether the arena is registered, so reads can use READ_FIXED */
+    bool fixed_buffers = false;
+
+    ~IoRing() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+        if (sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_size);
+        if (fd >= 0) close(fd);
+    }
+};
+
+/**
+ * @brief Sets up an io_uring instance and registers the read arena.
+ *
+ * @param entries Submission queue size.
+ * @param arena Buffer the files are read into.
+ * @param arena_size Size of the arena in bytes.
+ * @return std::unique_ptr<IoRing> The ring, or nullptr if io_uring is unavailable.
+ */
+static std::unique_ptr<IoRing> open_ring(const unsigned entries, unsigned char* arena, const size_t arena_size) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    auto ring = std::make_unique<IoRing>();
+    ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring->fd < 0) return nullptr;
+    ring->entries = params.sq_entries;
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) ring->sq_size = ring->cq_size = std::max(ring->sq_size, ring->cq_size);
+
+    ring->sq_ptr = mmap(nullptr, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) return nullptr;
+    ring->cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP)
+                       ? ring->sq_ptr
+                       : mmap(nullptr, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED) return nullptr;
+
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) return nullptr;
+
+    auto* sq = static_cast<unsigned char*>(ring->sq_ptr);
+    auto* cq = static_cast<unsigned char*>(ring->cq_ptr);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Registered buffers skip the per-read page pinning; plain reads still work without them.
+    iovec arena_iov{arena, arena_size};
+    ring->fixed_buffers = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, &arena_iov, 1) == 0;
+
+    return ring;
+}
+
+/**
+ * @brief Returns the next free submission entry, cleared; the caller never
+ * queues more than the ring holds.
+ *
+ * The kernel does not see the entry until push_sqe() publishes it, once all
+ * its fields are written.
+ */
+static io_uring_sqe* next_sqe(IoRing& ring) {
+    io_uring_sqe* sqe = &ring.sqes[*ring.sq_tail & *ring.sq_mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/**
+ * @brief Publishes the entry returned by next_sqe() to the kernel.
+ */
+static void push_sqe(IoRing& ring) {
+    const unsigned tail = *ring.sq_tail;
+    const unsigned index = tail & *ring.sq_mask;
+    ring.sq_array[index] = index;
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring.to_submit++;
+}
+
+/**
+ * @brief Submits the queued entries and waits until at least one completion is available.
+ *
+ * @return int 0 on success, or a negative errno.
+ */
+static int submit_and_wait(IoRing& ring) {
+    for (;;) {
+        const long ret = syscall(__NR_io_uring_enter, ring.fd, ring.to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret >= 0) {
+            ring.to_submit -= static_cast<unsigned>(ret);
+            return 0;
+        }
+        if (errno != EINTR) return -errno;
+    }
+}
+
+/**
+ * @brief Waits for the completions of `expected` tagged requests.
+ *
+ * Completions of close requests from earlier batches are reaped on the way.
+ *
+ * @param ring The ring.
+ * @param expected Number of non-close requests in flight.
+ * @param results Receives the result of request i at index i.
+ * @return int 0 on success, or a negative errno if the ring itself failed.
+ */
+static int wait_for(IoRing& ring, size_t expected, std::vector<int>& results) {
+    while (expected > 0) {
+        if (const int err = submit_and_wait(ring); err != 0) return err;
+
+        unsigned head = *ring.cq_head;
+        const unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = ring.cqes[head & *ring.cq_mask];
+            if (cqe.user_data == kCloseTag) {
+                ring.closes_in_flight--;
+            } else if (cqe.user_data != kCancelTag) {
+                results[cqe.user_data] = cqe.res;
+                expected--;
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+/**
+ * @brief Cancels the requests whose completion has not been reaped and waits for them.
+ *
+ * A read still in flight may write into its buffer at any time, even after
+ * the ring is closed, so the buffer can only be reused once the read's
+ * completion is reaped. A cancelled read completes with -ECANCELED; one the
+ * kernel can no longer stop completes normally.
+ *
+ * @param ring The ring.
+ * @param results Results of the requests; kPending for those still in flight.
+ * @return int 0 once every request has completed, or a negative errno if the ring failed again.
+ */
+static int cancel_pending(IoRing& ring, std::vector<int>& results) {
+    size_t pending = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i] != kPending) continue;
+        io_uring_sqe* sqe = next_sqe(ring);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = i;
+        sqe->user_data = kCancelTag;
+        push_sqe(ring);
+        pending++;
+    }
+    return wait_for(ring, pending, results);
+}
+
+/**
+ * @brief Submits the pending closes and waits for all of them.
+ */
+static void drain_closes(IoRing& ring) {
+    while (ring.closes_in_flight > 0 && submit_and_wait(ring) == 0) {
+        unsigned head = *ring.cq_head;
+        const unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            if (ring.cqes[head & *ring.cq_mask].user_data == kCloseTag) ring.closes_in_flight--;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+#else
+/*! io_uring is not available on this platform. */
+struct IoRing {};
+#endif
+
+/**
+ * @brief Starts reading the files in the background.
+ *
+ * @param paths Files to read, in the order they will be taken.
+ * @param sizes Their sizes on disk; all at most kMaxFileSize.
+ * @param slots Number of files that may be held in memory at once.
+ */
+SmallFileReader::SmallFileReader(std::vector<std::string> paths, std::vector<uint64_t> sizes, const int slots)
+    : paths_(std::move(paths)), sizes_(std::move(sizes)), files_(paths_.size()),
+      arena_(static_cast<size_t>(std::max(slots, 1)) * kMaxFileSize) {
+    for (int slot = std::max(slots, 1) - 1; slot >= 0; slot--) free_slots_.push_back(slot);
+
+#ifdef DBC_HAVE_IO_URING
+    ring_ = open_ring(2 * kBatch, arena_.data(), arena_.size());
+#endif
+
+    thread_ = std::thread([this] { run(); });
+}
+
+SmallFileReader::~SmallFileReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    slot_cv_.notify_all();
+    ready_cv_.notify_all();
+    thread_.join();
+}
+
+/**
+ * @brief Waits until a file is read and returns its contents.
+ *
+ * The buffer stays valid until it is handed back with release().
+ *
+ * @param index Position of the file in the list given to the constructor.
+ * @return PrefetchedFile The contents; data is nullptr if the file must be read normally.
+ */
+arrow::Result<PrefetchedFile> SmallFileReader::take(const size_t index) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cv_.wait(lock, [&] { return stop_ || files_[index].done; });
+    const FileState& file = files_[index];
+    if (!file.done) return arrow::Status::Cancelled("reader stopped");
+    ARROW_RETURN_NOT_OK(file.status);
+
+    PrefetchedFile result;
+    if (file.slot >= 0) {
+        result.data = arena_.data() + static_cast<size_t>(file.slot) * kMaxFileSize;
+        result.size = file.size;
+        result.slot = file.slot;
+    }
+    return result;
+}
+
+/**
+ * @brief Hands a buffer slot back so that the next files can be read into it.
+ */
+void SmallFileReader::release(const PrefetchedFile& file) {
+    if (file.slot < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_slots_.push_back(file.slot);
+    }
+    slot_cv_.notify_one();
+}
+
+/**
+ * @brief Records the outcome of one file and wakes the threads waiting for it.
+ *
+ * Files that failed, or that filled their whole slot and may be larger, give
+ * their slot back right away.
+ */
+void SmallFileReader::finish(const size_t index, arrow::Status status, const size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileState& file = files_[index];
+        file.done = true;
+        file.status = std::move(status);
+        file.size = size;
+        if (!file.status.ok() || size >= kMaxFileSize) {
+            if (file.slot >= 0) free_slots_.push_back(file.slot);
+            file.slot = -1;
+        }
+    }
+    ready_cv_.notify_all();
+}
+
+/**
+ * @brief Background loop: reads the files in order, a batch at a time, as slots free up.
+ */
+void SmallFileReader::run() {
+    size_t next = 0;
+    while (next < paths_.size()) {
+        std::vector<size_t> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            slot_cv_.wait(lock, [&] { return stop_ || slots_lost_ || !free_slots_.empty(); });
+            if (stop_) break;
+            if (slots_lost_) {
+                // Some slots may still be written by the kernel: hand the rest of the files over unread.
+                lock.unlock();
+                for (; next < paths_.size(); next++) finish(next, arrow::Status::OK(), 0);
+                break;
+            }
+            while (next < paths_.size() && batch.size() < kBatch && !free_slots_.empty()) {
+                files_[next].slot = free_slots_.back();
+                free_slots_.pop_back();
+                batch.push_back(next++);
+            }
+        }
+        read_batch(batch);
+    }
+
+#ifdef DBC_HAVE_IO_URING
+    if (ring_) drain_closes(*ring_);
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * @brief Reads the rest of an open file into its slot with pread().
+ *
+ * @param fd The open file.
+ * @param buffer The slot.
+ * @param size Bytes already read; updated.
+ * @return int 0 on success, or an errno value.
+ */
+static int pread_rest(const int fd, unsigned char* buffer, size_t& size) {
+    while (size < SmallFileReader::kMaxFileSize) {
+        const ssize_t n = pread(fd, buffer + size, SmallFileReader::kMaxFileSize - size, static_cast<off_t>(size));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return errno;
+        if (n == 0) break;
+        size += static_cast<size_t>(n);
+    }
+    return 0;
+}
+#endif
+
+/**
+ * @brief Reads one file into its slot without io_uring.
+ */
+void SmallFileReader::read_with_pread(const size_t index) {
+    unsigned char* buffer = arena_.data() + static_cast<size_t>(files_[index].slot) * kMaxFileSize;
+    size_t size = 0;
+
+#ifdef _WIN32
+    FILE* file = fopen(paths_[index].c_str(), "rb");
+    if (!file) return finish(index, arrow::Status::IOError("Error opening input file: ", paths_[index]), 0);
+    size = fread(buffer, 1, kMaxFileSize, file);
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed) return finish(index, arrow::Status::IOError("Error reading input file: ", paths_[index]), 0);
+#else
+    const int fd = open(paths_[index].c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return finish(index, arrow::Status::IOError("Error opening input file: ", paths_[index], ": ", std::strerror(errno)), 0);
+    const int err = pread_rest(fd, buffer, size);
+    close(fd);
+    if (err != 0) return finish(index, arrow::Status::IOError("Error reading input file: ", paths_[index], ": ", std::strerror(err)), 0);
+#endif
+
+    finish(index, arrow::Status::OK(), size);
+}
+
+/**
+ * @brief Reads a batch of files, each into the slot assigned to it.
+ *
+ * If the ring itself fails, the reads still in flight are cancelled and
+ * reaped, the files already opened are closed or read with pread() and the
+ * ring is dropped, so later batches use pread() too. A read that cannot be
+ * reaped keeps its slot out of use for good: its file, and every file after
+ * it, is handed over unread.
+ */
+void SmallFileReader::read_batch(const std::vector<size_t>& batch) {
+#ifdef DBC_HAVE_IO_URING
+    if (ring_) {
+        IoRing& ring = *ring_;
+        std::vector<int> fds(batch.size(), -1);
+
+        // One submission opens every file of the batch (and closes the previous batch's).
+        for (size_t i = 0; i < batch.size(); i++) {
+            io_uring_sqe* sqe = next_sqe(ring);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uintptr_t>(paths_[batch[i]].c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = i;
+            push_sqe(ring);
+        }
+        if (wait_for(ring, batch.size(), fds) != 0) {
+            ring_.reset();
+            for (const int fd : fds) {
+                if (fd >= 0) close(fd);
+            }
+            for (const size_t index : batch) read_with_pread(index);
+            return;
+        }
+
+        // A second one reads every opened file whole into its slot.
+        std::vector<int> reads(batch.size(), 0);
+        size_t pending = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (fds[i] < 0) {
+                // Kernels before 5.6 reject IORING_OP_OPENAT; read those files the portable way.
+                if (fds[i] == -EINVAL || fds[i] == -EOPNOTSUPP) read_with_pread(batch[i]);
+                else finish(batch[i], arrow::Status::IOError("Error opening input file: ", paths_[batch[i]], ": ", std::strerror(-fds[i])), 0);
+                continue;
+            }
+            io_uring_sqe* sqe = next_sqe(ring);
+            sqe->opcode = ring.fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe->fd = fds[i];
+            sqe->addr = reinterpret_cast<uintptr_t>(arena_.data() + static_cast<size_t>(files_[batch[i]].slot) * kMaxFileSize);
+            sqe->len = static_cast<unsigned>(kMaxFileSize);
+            sqe->off = 0;
+            sqe->buf_index = 0;
+            sqe->user_data = i;
+            push_sqe(ring);
+            reads[i] = kPending;
+            pending++;
+        }
+        const bool failed = wait_for(ring, pending, reads) != 0;
+        // Closing the ring does not stop the reads still in flight, so they are
+        // cancelled and reaped before their slots are read into again.
+        const bool in_flight = failed && cancel_pending(ring, reads) != 0;
+        if (failed) ring_.reset();
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (fds[i] < 0) continue;
+            if (in_flight && reads[i] == kPending) {
+                // The kernel may still write into this slot: never touch it again.
+                close(fds[i]);
+                files_[batch[i]].slot = -1;
+                slots_lost_ = true;
+                finish(batch[i], arrow::Status::OK(), 0);
+                continue;
+            }
+            unsigned char* buffer = arena_.data() + static_cast<size_t>(files_[batch[i]].slot) * kMaxFileSize;
+            size_t size = !failed && reads[i] > 0 ? static_cast<size_t>(reads[i]) : 0;
+            int read_err = !failed && reads[i] < 0 ? -reads[i] : 0;
+
+            // A short read of a file that should be longer is finished with pread, as is every file once the ring failed.
+            if (read_err == 0 && size < sizes_[batch[i]]) read_err = pread_rest(fds[i], buffer, size);
+            if (read_err != 0) {
+                finish(batch[i], arrow::Status::IOError("Error reading input file: ", paths_[batch[i]], ": ", std::strerror(read_err)), 0);
+            } else {
+                finish(batch[i], arrow::Status::OK(), size);
+            }
+
+            if (failed) {
+                close(fds[i]);
+                continue;
+            }
+            io_uring_sqe* sqe = next_sqe(ring);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fds[i];
+            sqe->user_data = kCloseTag;
+            push_sqe(ring);
+            ring.closes_in_flight++;
+        }
+        return;
+    }
+#endif
+
+    for (const size_t index : batch) read_with_pread(index);
+}
@@ -0,0 +1,96 @@
+/*****************************************************************************
+ * small_file_reader.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for small_file_reader.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef SMALL_FILE_READER_H
+#define SMALL_FILE_READER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arrow/result.h>
+#include <arrow/status.h>
+
+/*! \struct PrefetchedFile
+	\brief Whole contents of a file read ahead by SmallFileReader
+*/
+struct PrefetchedFile {
+    /*! file contents, or nullptr if the file did not fit a slot and must be read normally */
+    const unsigned char* data = nullptr;
+    /*! size of the contents */
+    size_t size = 0;
+    /*! buffer slot to hand back with release() */
+    int slot = -1;
+};
+
+struct IoRing;
+
+/*! \class SmallFileReader
+	\brief Reads many small files ahead of their consumers, in batches
+
+	A background thread reads the files, in the order given, into a fixed set
+	of buffer slots. On Linux it submits the opens of a batch in one
+	io_uring_enter() call and their whole-file reads, into registered
+	buffers, in another; elsewhere, or when io_uring is unavailable, it
+	falls back to open() and pread().
+*/
+class SmallFileReader {
+public:
+    /*! largest file worth prefetching, and the size of each slot */
+    static constexpr size_t kMaxFileSize = 1 << 20;
+
+    SmallFileReader(std::vector<std::string> paths, std::vector<uint64_t> sizes, int slots);
+    ~SmallFileReader();
+    SmallFileReader(const SmallFileReader&) = delete;
+    SmallFileReader& operator=(const SmallFileReader&) = delete;
+
+    arrow::Result<PrefetchedFile> take(size_t index);
+    void release(const PrefetchedFile& file);
+
+    /*! bytes held by the buffer slots */
+    size_t arena_size() const { return arena_.size(); }
+
+private:
+    /*! Read state of one file. */
+    struct FileState {
+        bool done = false;
+        arrow::Status status;
+        size_t size = 0;
+        int slot = -1;
+    };
+
+    void run();
+    void read_batch(const std::vector<size_t>& batch);
+    void read_with_pread(size_t index);
+    void finish(size_t index, arrow::Status status, size_t size);
+
+    std::vector<std::string> paths_;
+    std::vector<uint64_t> sizes_;
+    std::vector<FileState> files_;
+    std::vector<unsigned char> arena_;
+    std::vector<int> free_slots_;
+    std::unique_ptr<IoRing> ring_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::condition_variable slot_cv_;
+    bool stop_ = false;
+    /*! a slot may still be written by a read that could not be reaped; only the reader thread uses it */
+    bool slots_lost_ = false;
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*****************************************************************************
+ * @file sys_limits.cpp
+ * @brief Detects the CPU and memory limits of the process.
+ *
+ * Inside a container the host's core count and RAM are the wrong defaults:
+ * a pod limited to 2 CPUs and 4 GB still sees every core and all memory of
+ * the node. The limits are taken, tightest first, from the cgroup the
+ * process belongs to (cpu.max / memory.max on v2, cfs_quota_us /
+ * memory.limit_in_bytes on v1, checked up to the cgroup root), the CPU
+ * affinity mask and the physical RAM.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sys_limits.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+/*! Paths of this process inside each cgroup hierarchy, from /proc/self/cgroup. */
+struct CgroupPaths {
+    std::string v2;
+    std::string cpu_v1;
+    std::string memory_v1;
+    bool has_v2 = false;
+};
+
+/**
+ * @brief Reads the first line of a small text file.
+ *
+ * @param path The file path.
+ * @param line Receives the line.
+ * @return bool true if the file could be read.
+ */
+static bool read_first_line(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    return file && std::getline(file, line) && !line.empty();
+}
+
+/**
+ * @brief Parses /proc/self/cgroup ("id:controllers:path" per line).
+ */
+static CgroupPaths read_cgroup_paths() {
+    CgroupPaths paths;
+    std::ifstream file("/proc/self/cgroup");
+    std::string line;
+
+    while (std::getline(file, line)) {
+        const size_t first = line.find(':');
+        const size_t second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) continue;
+
+        const std::string controllers = line.substr(first + 1, second - first - 1);
+        const std::string path = line.substr(second + 1);
+
+        if (line.compare(0, first, "0") == 0 && controllers.empty()) {
+            paths.v2 = path;
+            paths.has_v2 = true;
+            continue;
+        }
+
+        std::stringstream list(controllers);
+        std::string controller;
+        while (std::getline(list, controller, ',')) {
+            if (controller == "cpu") paths.cpu_v1 = path;
+            else if (controller == "memory") paths.memory_v1 = path;
+        }
+    }
+    return paths;
+}
+
+/**
+ * @brief Lists the directories of a cgroup and its ancestors, leaf first.
+ *
+ * Inside a cgroup namespace the path from /proc/self/cgroup may not exist
+ * below the mount point, which is then itself the process's cgroup; the
+ * mount point is always the last entry.
+ *
+ * @param mount Mount point of the hierarchy.
+ * @param path Path of the cgroup inside the hierarchy.
+ * @return std::vector<std::string> Existing directories to check.
+ */
+static std::vector<std::string> cgroup_dirs(const std::string& mount, std::string path) {
+    std::vector<std::string> dirs;
+    while (!path.empty() && path != "/") {
+        std::ifstream probe(mount + path + "/cgroup.procs");
+        if (probe) dirs.push_back(mount + path);
+        path.resize(path.find_last_of('/'));
+    }
+    dirs.push_back(mount);
+    return dirs;
+}
+
+/**
+ * @brief Parses a decimal limit, treating "max" and absurd values as unlimited.
+ *
+ * @return int64_t The limit, or 0 if unlimited or unreadable.
+ */
+static int64_t parse_limit(const std::string& text) {
+    if (text.empty() || text == "max") return 0;
+    try {
+        const long long value = std::stoll(text);
+        // cgroup v1 reports "no limit" as a page-rounded LLONG_MAX.
+        return value > 0 && value < (1LL << 60) ? value : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+/**
+ * @brief Applies the cgroup CPU quota and memory limit to the limits found so far.
+ */
+static void apply_cgroup_limits(SystemLimits& limits) {
+    const CgroupPaths paths = read_cgroup_paths();
+    int quota_cpus = 0;
+    int64_t memory = 0;
+    std::string cpu_source;
+    std::string memory_source;
+
+    auto keep_cpus = [&](const int64_t quota, const int64_t period, const char* source) {
+        if (quota <= 0 || period <= 0) return;
+        const int cpus = static_cast<int>(std::max<int64_t>(1, (quota + period - 1) / period));
+        if (quota_cpus == 0 || cpus < quota_cpus) {
+            quota_cpus = cpus;
+            cpu_source = source;
+        }
+    };
+    auto keep_memory = [&](const int64_t bytes, const char* source) {
+        if (bytes > 0 && (memory == 0 || bytes < memory)) {
+            memory = bytes;
+            memory_source = source;
+        }
+    };
+
+    std::string line;
+    if (paths.has_v2 && read_first_line("/sys/fs/cgroup/cgroup.controllers", line)) {
+        for (const auto& dir : cgroup_dirs("/sys/fs/cgroup", paths.v2)) {
+            if (read_first_line(dir + "/cpu.max", line)) {
+                std::stringstream fields(line);
+                std::string quota, period;
+                fields >> quota >> period;
+                keep_cpus(parse_limit(quota), parse_limit(period), "cgroup v2 cpu.max");
+            }
+            if (read_first_line(dir + "/memory.max", line)) keep_memory(parse_limit(line), "cgroup v2 memory.max");
+        }
+    } else {
+        for (const char* mount : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"}) {
+            std::string quota, period;
+            for (const auto& dir : cgroup_dirs(mount, paths.cpu_v1)) {
+                if (read_first_line(dir + "/cpu.cfs_quota_us", quota) && read_first_line(dir + "/cpu.cfs_period_us", period))
+                    keep_cpus(parse_limit(quota), parse_limit(period), "cgroup v1 cpu.cfs_quota_us");
+            }
+            if (quota_cpus > 0) break;
+        }
+        for (const auto& dir : cgroup_dirs("/sys/fs/cgroup/memory", paths.memory_v1)) {
+            if (read_first_line(dir + "/memory.limit_in_bytes", line))
+                keep_memory(parse_limit(line), "cgroup v1 memory.limit_in_bytes");
+        }
+    }
+
+    if (quota_cpus > 0 && quota_cpus < limits.cpus) {
+        limits.cpus = quota_cpus;
+        limits.cpu_source = cpu_source;
+    }
+    if (memory > 0 && (limits.memory == 0 || memory < limits.memory)) {
+        limits.memory = memory;
+        limits.memory_source = memory_source;
+    }
+}
+#endif
+
+/**
+ * @brief Detects the CPUs and memory this process may use.
+ *
+ * @return SystemLimits The tightest limits found; cpus is at least 1.
+ */
+SystemLimits detect_system_limits() {
+    SystemLimits limits;
+    limits.cpus = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    limits.cpu_source = "hardware";
+
+#ifdef _WIN32
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) && process_mask != 0) {
+        int cpus = 0;
+        for (DWORD_PTR mask = process_mask; mask; mask &= mask - 1) cpus++;
+        if (cpus < limits.cpus) {
+            limits.cpus = cpus;
+            limits.cpu_source = "affinity mask";
+        }
+    }
+
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        limits.memory = static_cast<int64_t>(status.ullTotalPhys);
+        limits.memory_source = "physical RAM";
+    }
+#else
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+        limits.memory = static_cast<int64_t>(pages) * page_size;
+        limits.memory_source = "physical RAM";
+    }
+#endif
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        const int cpus = CPU_COUNT(&set);
+        if (cpus > 0 && cpus < limits.cpus) {
+            limits.cpus = cpus;
+            limits.cpu_source = "affinity mask";
+        }
+    }
+
+    apply_cgroup_limits(limits);
+#endif
+
+    return limits;
+}
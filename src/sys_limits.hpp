@@ -0,0 +1,40 @@
+/*****************************************************************************
+ * sys_limits.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for sys_limits.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef SYS_LIMITS_H
+#define SYS_LIMITS_H
+
+#include <cstdint>
+#include <string>
+
+/*! \struct SystemLimits
+	\brief CPU and memory actually available to this process
+*/
+struct SystemLimits {
+    /*! CPUs the process may use (affinity mask and CPU quota) */
+    int cpus = 1;
+    /*! where cpus was read from */
+    std::string cpu_source;
+    /*! bytes the process may use; 0 if unknown */
+    int64_t memory = 0;
+    /*! where memory was read from */
+    std::string memory_source;
+};
+
+/* detect_system_limits()
+ * Reads the cgroup (v1 or v2) CPU quota and memory limit, the CPU affinity
+ * mask and the physical RAM, keeping the tightest of each.
+ */
+SystemLimits detect_system_limits();
+
+#endif
@@ -0,0 +1,357 @@
+/*****************************************************************************
+ * @file watch.cpp
+ * @brief Converts DBC files as they land in a directory (--watch).
+ *
+ * The directory tree is watched with inotify. A DBC file is queued once it
+ * has been closed after writing (or moved in) and then left alone for a
+ * short debounce interval, so a client that reopens the file to append does
+ * not get it converted half-written. Queued files are converted by a fixed
+ * number of threads under the usual memory budget. Each output is written
+ * to a hidden temporary file next to its destination and renamed into place,
+ * so readers of the output tree never see a partial Parquet file.
+ *
+ * On startup, and after an inotify queue overflow, the tree is rescanned and
+ * every DBC file without an up-to-date output is queued, so files that
+ * arrived while the watcher was down are not missed.
+ *
+ * @author Raicy Augusto
+ * @copyright Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#include "watch.hpp"
+
+#ifndef __linux__
+
+arrow::Status run_watch(const std::string&, const std::string&, const ConvertOptions&, int) {
+    return arrow::Status::NotImplemented("--watch needs inotify (Linux)");
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "batch_convert.hpp"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+/*! quiet time after the last write before a file is converted */
+static constexpr auto kDebounce = std::chrono::milliseconds(1000);
+
+static std::atomic<bool> g_stop{false};
+
+static void on_stop_signal(int) {
+    g_stop = true;
+}
+
+/*! \struct WatchState
+	\brief Files waiting out their debounce, queued and being converted
+*/
+struct WatchState {
+    fs::path root;
+    fs::path output_root;
+    const ConvertOptions& options;
+
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    /*! path -> time it may be queued, pushed back by every new write */
+    std::map<std::string, Clock::time_point> pending;
+    std::deque<std::string> ready;
+    /*! queued or being converted; a new write waits until it is done */
+    std::set<std::string> active;
+    bool stop = false;
+
+    std::atomic<int64_t> converted{0};
+    std::atomic<int64_t> failed{0};
+
+    WatchState(fs::path root, fs::path output_root, const ConvertOptions& options)
+        : root(std::move(root)), output_root(std::move(output_root)), options(options) {}
+
+    /**
+     * @brief Output path of a file of the watched tree, keeping its subdirectory.
+     */
+    std::string output_for(const fs::path& input) const {
+        const fs::path output = output_root.empty() ? input : output_root / input.lexically_relative(root);
+        return generate_output_filename(output.string(), options.output_extension());
+    }
+
+    /**
+     * @brief File whose modification time tells when a file was last converted.
+     *
+     * Partitioned output is a directory tree with nothing at output_for(), so
+     * a hidden marker next to it is touched once a conversion succeeds. Split
+     * output is judged by its first part, which every conversion writes.
+     */
+    fs::path converted_marker(const fs::path& input) const {
+        const std::string output = output_for(input);
+        if (!options.partition_by.empty()) {
+            const fs::path path(output);
+            return path.parent_path() / ("." + path.filename().string() + ".converted");
+        }
+        if (options.max_file_bytes > 0 || options.max_file_rows > 0) return part_path(output, 0);
+        return output;
+    }
+
+    /**
+     * @brief Queues a file after the debounce interval, restarting it if already waiting.
+     */
+    void schedule(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[path] = Clock::now() + kDebounce;
+    }
+
+    /**
+     * @brief Queues the files whose debounce interval has passed.
+     *
+     * @return Clock::time_point When the next waiting file is due, or max() if none.
+     */
+    Clock::time_point release_due() {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto now = Clock::now();
+        auto next = Clock::time_point::max();
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second > now) {
+                next = std::min(next, it->second);
+                ++it;
+            } else if (active.count(it->first)) {
+                // Still converting the previous version; try again later
+                it->second = now + kDebounce;
+                next = std::min(next, it->second);
+                ++it;
+            } else {
+                active.insert(it->first);
+                ready.push_back(it->first);
+                ready_cv.notify_one();
+                it = pending.erase(it);
+            }
+        }
+        return next;
+    }
+};
+
+/**
+ * @brief Checks whether a DBC file has no output yet, or only an older one.
+ */
+static bool needs_conversion(const fs::path& input, const fs::path& output) {
+    std::error_code ec;
+    const auto output_time = fs::last_write_time(output, ec);
+    if (ec) return true;
+    const auto input_time = fs::last_write_time(input, ec);
+    return ec || output_time < input_time;
+}
+
+/**
+ * @brief Converts one file through a temporary file renamed into place.
+ */
+static void convert_arrival(WatchState& state, const std::string& input) {
+    const fs::path output = state.output_for(input);
+    // Partitioned and split output already renames each of its files into place
+    const bool direct = !state.options.single_file();
+    const fs::path temp = direct ? output : output.parent_path() / ("." + output.filename().string() + ".tmp");
+
+    const auto start = Clock::now();
+    int64_t rows = 0;
+    arrow::Status status;
+    try {
+        if (!output.parent_path().empty()) fs::create_directories(output.parent_path());
+        status = convert_file(input, temp.string(), state.options, &rows);
+        if (status.ok() && !direct) {
+            std::error_code ec;
+            fs::rename(temp, output, ec);
+            if (ec) {
+                fs::remove(temp, ec);
+                status = arrow::Status::IOError("Cannot rename ", temp.string(), " to ", output.string());
+            }
+        }
+    } catch (const std::exception& e) {
+        std::error_code ec;
+        fs::remove(temp, ec);
+        status = arrow::Status::UnknownError(input, ": ", e.what());
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (status.ok() && !state.options.partition_by.empty()) {
+        // A marker that cannot be written only costs a reconversion on the next start
+        std::ofstream marker(state.converted_marker(input), std::ios::trunc);
+    }
+
+    std::ostringstream line;
+    if (status.ok()) {
+        state.converted++;
+        line << input << " -> " << output.string() << " (" << rows << " rows, " << seconds << " s)\n";
+        std::cout << line.str() << std::flush;
+    } else {
+        state.failed++;
+        line << input << " FAILED: " << status.ToString() << "\n";
+        std::cerr << line.str();
+    }
+}
+
+/**
+ * @brief Converts queued files until the watcher stops.
+ */
+static void convert_worker(WatchState& state) {
+    while (true) {
+        std::string input;
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.ready_cv.wait(lock, [&] { return state.stop || !state.ready.empty(); });
+            if (state.stop) return;
+            input = std::move(state.ready.front());
+            state.ready.pop_front();
+        }
+        convert_arrival(state, input);
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.active.erase(input);
+    }
+}
+
+/*! inotify watches of the directories of the tree */
+struct DirectoryWatches {
+    int fd;
+    std::unordered_map<int, fs::path> dirs;
+
+    /**
+     * @brief Watches a directory and its subdirectories, and schedules the
+     * DBC files found there that have no up-to-date output.
+     */
+    void add_tree(const fs::path& dir, WatchState& state) {
+        add(dir);
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (it->is_directory(ec)) {
+                add(it->path());
+            } else if (it->is_regular_file(ec) && is_dbc_path(it->path()) &&
+                       needs_conversion(it->path(), state.converted_marker(it->path()))) {
+                state.schedule(it->path().string());
+            }
+        }
+    }
+
+    void add(const fs::path& dir) {
+        const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY | IN_CREATE | IN_ONLYDIR;
+        const int wd = inotify_add_watch(fd, dir.c_str(), mask);
+        if (wd >= 0) dirs[wd] = dir;
+        else std::cerr << "Cannot watch " << dir.string() << ": " << std::strerror(errno) << "\n";
+    }
+};
+
+/**
+ * @brief Converts DBC files written into a directory tree until stopped.
+ *
+ * @param dir Directory to watch, with its subdirectories.
+ * @param output_dir Root of the output tree, or empty to write next to each input.
+ * @param options Conversion options, shared by all files.
+ * @param parallel_jobs Number of files converted at the same time.
+ * @return arrow::Status OK after SIGINT or SIGTERM.
+ */
+arrow::Status run_watch(const std::string& dir, const std::string& output_dir, const ConvertOptions& options,
+                        const int parallel_jobs) {
+    std::error_code ec;
+    if (!fs::is_directory(dir, ec)) return arrow::Status::IOError("Not a directory: ", dir);
+
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return arrow::Status::IOError("inotify_init1: ", std::strerror(errno));
+
+    g_stop = false;
+    struct sigaction action{};
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    WatchState state(fs::path(dir), fs::path(output_dir), options);
+    DirectoryWatches watches{fd, {}};
+    watches.add_tree(state.root, state);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::max(parallel_jobs, 1); i++) workers.emplace_back(convert_worker, std::ref(state));
+
+    std::cout << "Watching " << dir << " (" << std::max(parallel_jobs, 1) << " at a time)\n" << std::flush;
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (!g_stop) {
+        const auto next = state.release_due();
+        int timeout = 200;
+        if (next != Clock::time_point::max()) {
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+            timeout = static_cast<int>(std::clamp<int64_t>(wait + 1, 1, timeout));
+        }
+
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout) <= 0) continue;
+
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were lost; fall back to a rescan
+                    watches.add_tree(state.root, state);
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    watches.dirs.erase(event->wd);
+                    continue;
+                }
+                const auto dir_it = watches.dirs.find(event->wd);
+                if (dir_it == watches.dirs.end() || event->len == 0) continue;
+                const fs::path path = dir_it->second / event->name;
+
+                if (event->mask & IN_ISDIR) {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) watches.add_tree(path, state);
+                } else if (is_dbc_path(path)) {
+                    if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                        state.schedule(path.string());
+                    } else if (event->mask & IN_MODIFY) {
+                        // Still being written: restart the debounce of a file already closed once
+                        std::lock_guard<std::mutex> lock(state.mutex);
+                        auto it = state.pending.find(path.string());
+                        if (it != state.pending.end()) it->second = Clock::now() + kDebounce;
+                    }
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stop = true;
+    }
+    state.ready_cv.notify_all();
+    for (auto& worker : workers) worker.join();
+    close(fd);
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::cout << "Stopped watching after " << state.converted.load() << " file(s), " << state.failed.load()
+              << " failed\n";
+    return arrow::Status::OK();
+}
+
+#endif
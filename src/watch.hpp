@@ -0,0 +1,27 @@
+/*****************************************************************************
+ * watch.hpp
+ *
+ * Author: Raicy Augusto
+ * Copyright (C) 2025 Raicy Augusto
+ *
+ * This file is part of the dbc2parquet project.
+ * Interface for watch.cpp
+ *
+ * Licensed under the Apache License, Version 2.0.
+ * See LICENSE file for details.
+ ****************************************************************************/
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <string>
+#include <arrow/status.h>
+#include "parquet_write.hpp"
+
+/* run_watch()
+ * Converts DBC files as they are written into a directory, until SIGINT or SIGTERM.
+ */
+arrow::Status run_watch(const std::string& dir, const std::string& output_dir, const ConvertOptions& options,
+                        int parallel_jobs);
+
+#endif